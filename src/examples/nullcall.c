@@ -0,0 +1,68 @@
+/* nullcall.c
+
+   Times a system call that does no work, entering the kernel
+   first by int $0x30 and then by SYSENTER, and prints the CPU
+   cycles per call each way.
+
+   Usage: nullcall [CALLS] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+
+/* Default number of calls to time. */
+#define CALL_CNT 100000
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Makes CNT system calls that do nothing, entering the kernel by
+   SYSENTER if SYSENTER is true, and returns the cycles per
+   call.  The kernel rejects filesize() on a bad descriptor
+   without doing anything else. */
+static uint64_t
+time_calls (int cnt, bool sysenter)
+{
+  uint64_t start;
+  int i;
+
+  syscall_sysenter = sysenter;
+  start = rdtsc ();
+  for (i = 0; i < cnt; i++)
+    filesize (-1);
+  return (rdtsc () - start) / cnt;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int cnt = argc > 1 ? atoi (argv[1]) : CALL_CNT;
+  bool have_sysenter = syscall_sysenter;
+  uint64_t int_cycles, sysenter_cycles;
+
+  if (cnt <= 0)
+    {
+      printf ("usage: nullcall [CALLS]\n");
+      return EXIT_FAILURE;
+    }
+
+  int_cycles = time_calls (cnt, false);
+  printf ("int $0x30: %llu cycles per call (%d calls)\n", int_cycles, cnt);
+  if (!have_sysenter)
+    {
+      printf ("SYSENTER: not supported by this CPU\n");
+      return EXIT_SUCCESS;
+    }
+  sysenter_cycles = time_calls (cnt, true);
+  printf ("SYSENTER: %llu cycles per call (%d calls)\n",
+          sysenter_cycles, cnt);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/* ringbench.c
+
+   Writes many small records to a file, first with one write()
+   system call per record and then through a system call ring,
+   and prints the CPU cycles each way took.
+
+   Usage: ringbench [RECORDS] */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+
+/* Size of each record, in bytes. */
+#define RECORD_SIZE 16
+
+/* Default number of records to write. */
+#define RECORD_CNT 100000
+
+/* Files cannot grow, so the records go into a file created with
+   room for this many, rewinding to its start each time it
+   fills up.  Both ways of writing rewind at the same points. */
+#define REGION_RECORDS 4096
+
+/* user_data of a rewind on the ring. */
+#define SEEK_TAG UINT32_MAX
+
+/* Where to put the ring.  Must not overlap any other pages. */
+#define RING_ADDR ((uint8_t *) 0x10000000)
+#define RING_PAGE 4096
+
+static const char record[RECORD_SIZE] = "0123456789abcde\n";
+
+/* Returns the CPU's time-stamp counter. */
+static inline uint64_t
+rdtsc (void)
+{
+  uint32_t lo, hi;
+  asm volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+}
+
+/* Writes CNT records to FD, one write() call each, and a seek()
+   back to the start of the file every REGION_RECORDS records.
+   Returns the number of records that were not written in
+   full. */
+static int
+bench_write (int fd, int cnt)
+{
+  int bad = 0;
+  int i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      if (i % REGION_RECORDS == 0)
+        seek (fd, 0);
+      if (write (fd, record, RECORD_SIZE) != RECORD_SIZE)
+        bad++;
+    }
+  return bad;
+}
+
+/* Writes CNT records to FD like bench_write(), but through the
+   ring, filling its submission queue before each ring_enter()
+   call.  Returns the number of records that were not written in
+   full. */
+static int
+bench_ring (int fd, int cnt)
+{
+  struct ring_sq *sq = (struct ring_sq *) RING_ADDR;
+  struct ring_cq *cq = (struct ring_cq *) (RING_ADDR + RING_PAGE);
+  int submitted = 0, completed = 0;
+  bool rewound = false;
+  int bad = 0;
+
+  while (completed < cnt)
+    {
+      while (submitted < cnt && sq->tail - sq->head < RING_ENTRIES)
+        {
+          struct ring_sqe *sqe = &sq->entries[sq->tail % RING_ENTRIES];
+          sqe->fd = fd;
+          if (submitted % REGION_RECORDS == 0 && !rewound)
+            {
+              sqe->op = RING_SEEK;
+              sqe->buf = NULL;
+              sqe->len = 0;
+              sqe->user_data = SEEK_TAG;
+              rewound = true;
+            }
+          else
+            {
+              sqe->op = RING_WRITE;
+              sqe->buf = (void *) record;
+              sqe->len = RECORD_SIZE;
+              sqe->user_data = submitted++;
+              rewound = false;
+            }
+          sq->tail++;
+        }
+      if (ring_enter () < 0)
+        {
+          printf ("ringbench: ring_enter failed\n");
+          exit (EXIT_FAILURE);
+        }
+      for (; cq->head != cq->tail; cq->head++)
+        {
+          struct ring_cqe *cqe = &cq->entries[cq->head % RING_ENTRIES];
+          if (cqe->user_data == SEEK_TAG)
+            continue;
+          completed++;
+          if (cqe->res != RECORD_SIZE)
+            bad++;
+        }
+    }
+  return bad;
+}
+
+/* Creates "ringbench.dat" with room for up to REGION_RECORDS
+   records, writes CNT records to it with BENCH, and removes it
+   again.  Returns the CPU cycles the writes took, or 0 if any
+   write came up short. */
+static uint64_t
+run (const char *name, int (*bench) (int fd, int cnt), int cnt)
+{
+  int size = (cnt < REGION_RECORDS ? cnt : REGION_RECORDS) * RECORD_SIZE;
+  uint64_t start, cycles;
+  int fd, bad;
+
+  if (!create ("ringbench.dat", size) || (fd = open ("ringbench.dat")) < 0)
+    {
+      printf ("ringbench: can't create %d-byte ringbench.dat\n", size);
+      exit (EXIT_FAILURE);
+    }
+  start = rdtsc ();
+  bad = bench (fd, cnt);
+  cycles = rdtsc () - start;
+  close (fd);
+  remove ("ringbench.dat");
+
+  if (bad != 0)
+    {
+      printf ("%s: %d of %d records written short\n", name, bad, cnt);
+      return 0;
+    }
+  printf ("%s: %d records in %llu cycles, %llu per record\n",
+          name, cnt, cycles, cycles / cnt);
+  return cycles;
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int cnt = argc > 1 ? atoi (argv[1]) : RECORD_CNT;
+  uint64_t write_cycles, ring_cycles;
+
+  if (cnt <= 0)
+    {
+      printf ("usage: ringbench [RECORDS]\n");
+      return EXIT_FAILURE;
+    }
+  if (ring_setup (RING_ADDR) < 0)
+    {
+      printf ("ringbench: ring_setup failed\n");
+      return EXIT_FAILURE;
+    }
+
+  write_cycles = run ("write", bench_write, cnt);
+  ring_cycles = run ("ring", bench_ring, cnt);
+  if (write_cycles > 0 && ring_cycles > 0)
+    printf ("ring speedup: %llu.%02llux\n",
+            write_cycles / ring_cycles,
+            write_cycles * 100 / ring_cycles % 100);
+  return EXIT_SUCCESS;
+}
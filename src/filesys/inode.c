@@ -2,9 +2,11 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
 
 /* Identifies an inode. */
@@ -57,6 +59,11 @@ byte_to_sector (const struct inode *inode, off_t pos)
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Statistics.  Updated by count_bytes(). */
+static unsigned long long direct_bytes;  /* Bytes moved directly. */
+static unsigned long long bounce_bytes;  /* Bytes through a bounce buffer. */
+static unsigned long long copy_bytes;    /* Bytes inode_copy_at() moved. */
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
@@ -64,6 +71,21 @@ inode_init (void)
   list_init (&open_inodes);
 }
 
+/* Adds BYTES to statistics counter *COUNTER.  64-bit additions
+   are not atomic on this CPU, so interrupts are turned off
+   around the update. */
+static void
+count_bytes (unsigned long long *counter, off_t bytes) 
+{
+  enum intr_level old_level;
+
+  if (bytes == 0)
+    return;
+  old_level = intr_disable ();
+  *counter += bytes;
+  intr_set_level (old_level);
+}
+
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
    device.
@@ -202,7 +224,11 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 {
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
-  uint8_t *bounce = NULL;
+  off_t direct = 0, bounced = 0;
+
+  /* Bounce buffer for partial sectors.  Whole sectors move
+     straight between the disk and the caller's buffer. */
+  uint8_t bounce[BLOCK_SECTOR_SIZE];
 
   while (size > 0) 
     {
@@ -222,21 +248,23 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
-          /* Read full sector directly into caller's buffer. */
-          block_read (fs_device, sector_idx, buffer + bytes_read);
+          /* Read full sectors directly into caller's buffer.  A
+             file's sectors are contiguous on disk, so all the
+             whole sectors left to read go in one transfer. */
+          off_t whole = size < inode_left ? size : inode_left;
+          chunk_size = whole / BLOCK_SECTOR_SIZE * BLOCK_SECTOR_SIZE;
+          block_read_multiple (fs_device, sector_idx,
+                               chunk_size / BLOCK_SECTOR_SIZE,
+                               buffer + bytes_read);
+          direct += chunk_size;
         }
       else 
         {
           /* Read sector into bounce buffer, then partially copy
              into caller's buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
           block_read (fs_device, sector_idx, bounce);
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
+          bounced += chunk_size;
         }
       
       /* Advance. */
@@ -244,7 +272,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
-  free (bounce);
+  count_bytes (&direct_bytes, direct);
+  count_bytes (&bounce_bytes, bounced);
 
   return bytes_read;
 }
@@ -260,7 +289,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  off_t direct = 0, bounced = 0;
+
+  /* Bounce buffer for partial sectors.  Whole sectors move
+     straight between the caller's buffer and the disk. */
+  uint8_t bounce[BLOCK_SECTOR_SIZE];
 
   if (inode->deny_write_cnt)
     return 0;
@@ -285,17 +318,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
         {
           /* Write full sector directly to disk. */
           block_write (fs_device, sector_idx, buffer + bytes_written);
+          direct += chunk_size;
         }
       else 
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (BLOCK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
           /* If the sector contains data before or after the chunk
              we're writing, then we need to read in the sector
              first.  Otherwise we start with a sector of all zeros. */
@@ -305,6 +331,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
           block_write (fs_device, sector_idx, bounce);
+          bounced += chunk_size;
         }
 
       /* Advance. */
@@ -312,11 +339,76 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
+  count_bytes (&direct_bytes, direct);
+  count_bytes (&bounce_bytes, bounced);
 
   return bytes_written;
 }
 
+/* Copies SIZE bytes from SRC, starting at SRC_OFS, into DST,
+   starting at DST_OFS, without passing through a caller's
+   buffer.  Returns the number of bytes actually copied, which
+   may be less than SIZE if the end of either inode is reached.
+   The ranges must not overlap if SRC and DST are the same inode.
+
+   Inodes do not share sectors, so the data is copied a sector
+   at a time.  A sector whose range lines up with a whole sector
+   of DST goes straight from one sector to the other; the pieces
+   at unaligned ends go through inode_read_at() and
+   inode_write_at(). */
+off_t
+inode_copy_at (struct inode *dst, off_t dst_ofs,
+               struct inode *src, off_t src_ofs, off_t size) 
+{
+  off_t bytes_copied = 0;
+  uint8_t sector[BLOCK_SECTOR_SIZE];
+
+  if (dst->deny_write_cnt)
+    return 0;
+
+  while (size > 0) 
+    {
+      /* Bytes left in each inode and in each sector, and the
+         least of those. */
+      off_t src_left = inode_length (src) - src_ofs;
+      off_t dst_left = inode_length (dst) - dst_ofs;
+      int src_sector_left = BLOCK_SECTOR_SIZE - src_ofs % BLOCK_SECTOR_SIZE;
+      int dst_sector_left = BLOCK_SECTOR_SIZE - dst_ofs % BLOCK_SECTOR_SIZE;
+      off_t chunk_size = size;
+      if (src_left < chunk_size)
+        chunk_size = src_left;
+      if (dst_left < chunk_size)
+        chunk_size = dst_left;
+      if (src_sector_left < chunk_size)
+        chunk_size = src_sector_left;
+      if (dst_sector_left < chunk_size)
+        chunk_size = dst_sector_left;
+      if (chunk_size <= 0)
+        break;
+
+      if (chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          /* Both ranges cover a whole sector. */
+          block_read (fs_device, byte_to_sector (src, src_ofs), sector);
+          block_write (fs_device, byte_to_sector (dst, dst_ofs), sector);
+        }
+      else if (inode_read_at (src, sector, chunk_size, src_ofs)
+               != chunk_size
+               || inode_write_at (dst, sector, chunk_size, dst_ofs)
+               != chunk_size)
+        break;
+
+      /* Advance. */
+      size -= chunk_size;
+      src_ofs += chunk_size;
+      dst_ofs += chunk_size;
+      bytes_copied += chunk_size;
+    }
+  count_bytes (&copy_bytes, bytes_copied);
+
+  return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -343,3 +435,24 @@ inode_length (const struct inode *inode)
 {
   return inode->data.length;
 }
+
+/* Prints statistics on file data moved by inode_read_at() and
+   inode_write_at(): bytes that moved straight between the disk
+   and the caller's buffer, bytes that went through the bounce
+   buffer and so were copied twice, and the resulting number of
+   copies per byte.  Also prints how many bytes inode_copy_at()
+   copied from one inode to another. */
+void
+inode_print_stats (void) 
+{
+  unsigned long long total = direct_bytes + bounce_bytes;
+  unsigned long long copies = (total != 0
+                               ? (direct_bytes + 2 * bounce_bytes) * 100 / total
+                               : 0);
+
+  printf ("Inode: %llu bytes direct, %llu bytes bounced, "
+          "%llu.%02llu copies per byte\n",
+          direct_bytes, bounce_bytes, copies / 100, copies % 100);
+  if (copy_bytes != 0)
+    printf ("Inode: %llu bytes copied between inodes\n", copy_bytes);
+}
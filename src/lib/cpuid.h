@@ -0,0 +1,38 @@
+#ifndef __LIB_CPUID_H
+#define __LIB_CPUID_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Feature flags that CPUID leaf 1 returns in EDX. */
+#define CPUID_SEP (1u << 11)    /* SYSENTER and SYSEXIT. */
+
+/* Executes CPUID for LEAF and stores EAX, EBX, ECX, and EDX in
+   REGS[0] through REGS[3].  See [IA32-v2a] "CPUID". */
+static inline void
+cpuid (uint32_t leaf, uint32_t regs[4])
+{
+  asm volatile ("cpuid"
+                : "=a" (regs[0]), "=b" (regs[1]),
+                  "=c" (regs[2]), "=d" (regs[3])
+                : "a" (leaf));
+}
+
+/* Returns true if the CPU has the SYSENTER and SYSEXIT
+   instructions.  Early Pentium Pro processors set CPUID_SEP but
+   don't have them.  See [IA32-v2b] "SYSENTER". */
+static inline bool
+cpu_has_sysenter (void)
+{
+  uint32_t regs[4];
+  unsigned family, model, stepping;
+
+  cpuid (1, regs);
+  family = (regs[0] >> 8) & 0xf;
+  model = (regs[0] >> 4) & 0xf;
+  stepping = regs[0] & 0xf;
+  return ((regs[3] & CPUID_SEP) != 0
+          && !(family == 6 && model < 3 && stepping < 3));
+}
+
+#endif /* lib/cpuid.h */
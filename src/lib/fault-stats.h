@@ -0,0 +1,28 @@
+#ifndef __LIB_FAULT_STATS_H
+#define __LIB_FAULT_STATS_H
+
+#include <stdint.h>
+
+/* A process's page fault statistics, as returned by the
+   get_fault_stats() system call. */
+struct fault_stats
+  {
+    /* Page faults, by cause. */
+    unsigned not_present;       /* Access to a page not present. */
+    unsigned protection;        /* Write to a read-only page. */
+    uint64_t cycles;            /* CPU cycles spent handling them. */
+
+    /* Pages brought in, by source, whether for a fault or for a
+       system call's buffer. */
+    unsigned stack;             /* New stack pages. */
+    unsigned file;              /* From the executable or a mapping. */
+    unsigned swap;              /* From swap. */
+    unsigned zero;              /* Zero-filled, new stack included. */
+
+    /* Working set: pages accessed between samples. */
+    unsigned ws_pages;          /* Latest estimate. */
+    unsigned ws_peak;           /* Largest estimate. */
+    unsigned ws_samples;        /* Number of samples taken. */
+  };
+
+#endif /* lib/fault-stats.h */
@@ -0,0 +1,17 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* One buffer of a vectored read or write, as taken by the
+   readv() and writev() system calls. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Bytes in buffer. */
+  };
+
+/* Most buffers that one readv() or writev() call may take. */
+#define IOV_MAX 1024
+
+#endif /* lib/iovec.h */
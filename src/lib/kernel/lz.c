@@ -0,0 +1,164 @@
+#include "lz.h"
+#include <stdint.h>
+#include <string.h>
+#include "../debug.h"
+
+/* LZ77-style codec, tuned for speed over ratio.
+
+   The compressed data is a sequence of items, each introduced by
+   a token byte.  A token below 0x80 is followed by TOKEN + 1
+   literal bytes.  Any other token stands for a match of
+   (TOKEN & 0x7f) + LZ_MIN_MATCH bytes that repeat the output
+   starting some distance back, given by the two bytes that
+   follow it, least significant first.  A match may overlap the
+   bytes it produces, so a run of equal bytes compresses to a
+   literal and a chain of matches at distance 1.
+
+   The compressor finds matches through a hash table of the most
+   recent position of every 3-byte string, kept in caller-supplied
+   scratch memory.  It never searches further, so it misses some
+   matches but does a constant amount of work per input byte. */
+
+/* Shortest and longest matches. */
+#define LZ_MIN_MATCH 3
+#define LZ_MAX_MATCH (0x7f + LZ_MIN_MATCH)
+
+/* Most literals after one token. */
+#define LZ_MAX_LITERALS 0x80
+
+/* Number of hash table entries. */
+#define LZ_HASH_BITS 11
+#define LZ_HASH_CNT (1u << LZ_HASH_BITS)
+
+static unsigned hash3 (const uint8_t *);
+static uint8_t *put_literals (uint8_t *dst, uint8_t *dst_end,
+                              const uint8_t *src, size_t cnt);
+
+/* Compresses the SIZE bytes at SRC into the DST_SIZE bytes at
+   DST, using the LZ_WORK_SIZE bytes at WORK as scratch space.
+   Returns the number of bytes of compressed data, or 0 if it
+   would not fit in DST_SIZE bytes. */
+size_t
+lz_compress (const void *src_, size_t size, void *dst_, size_t dst_size,
+             void *work)
+{
+  const uint8_t *src = src_;
+  uint8_t *dst = dst_;
+  uint8_t *dst_end = dst + dst_size;
+  uint16_t *table = work;
+  size_t pos = 0;               /* Next byte to look at. */
+  size_t lit = 0;               /* First literal not yet written. */
+
+  ASSERT (size <= LZ_MAX_SIZE);
+  ASSERT (LZ_HASH_CNT * sizeof *table <= LZ_WORK_SIZE);
+
+  memset (table, 0, LZ_HASH_CNT * sizeof *table);
+  while (pos + LZ_MIN_MATCH <= size)
+    {
+      unsigned h = hash3 (src + pos);
+      size_t cand = table[h];
+
+      table[h] = pos;
+      if (cand < pos && !memcmp (src + cand, src + pos, LZ_MIN_MATCH))
+        {
+          size_t max = size - pos < LZ_MAX_MATCH ? size - pos : LZ_MAX_MATCH;
+          size_t len = LZ_MIN_MATCH;
+          size_t dist = pos - cand;
+
+          while (len < max && src[cand + len] == src[pos + len])
+            len++;
+
+          dst = put_literals (dst, dst_end, src + lit, pos - lit);
+          if (dst == NULL || dst_end - dst < 3)
+            return 0;
+          *dst++ = 0x80 | (len - LZ_MIN_MATCH);
+          *dst++ = dist & 0xff;
+          *dst++ = dist >> 8;
+          pos += len;
+          lit = pos;
+        }
+      else
+        pos++;
+    }
+
+  dst = put_literals (dst, dst_end, src + lit, size - lit);
+  return dst != NULL ? dst - (uint8_t *) dst_ : 0;
+}
+
+/* Decompresses the SIZE bytes of compressed data at SRC into the
+   DST_SIZE bytes at DST.  Returns true if successful, false if
+   the data is corrupt or does not decompress to exactly DST_SIZE
+   bytes. */
+bool
+lz_decompress (const void *src_, size_t size, void *dst_, size_t dst_size)
+{
+  const uint8_t *src = src_;
+  const uint8_t *src_end = src + size;
+  uint8_t *dst = dst_;
+  uint8_t *dst_end = dst + dst_size;
+
+  while (src < src_end)
+    {
+      unsigned token = *src++;
+
+      if (token < 0x80)
+        {
+          size_t cnt = token + 1;
+
+          if ((size_t) (src_end - src) < cnt
+              || (size_t) (dst_end - dst) < cnt)
+            return false;
+          memcpy (dst, src, cnt);
+          src += cnt;
+          dst += cnt;
+        }
+      else
+        {
+          size_t len = (token & 0x7f) + LZ_MIN_MATCH;
+          size_t dist;
+          const uint8_t *from;
+
+          if (src_end - src < 2)
+            return false;
+          dist = src[0] | (src[1] << 8);
+          src += 2;
+          if (dist == 0 || dist > (size_t) (dst - (uint8_t *) dst_)
+              || (size_t) (dst_end - dst) < len)
+            return false;
+
+          /* Byte by byte, since the match may overlap itself. */
+          for (from = dst - dist; len > 0; len--)
+            *dst++ = *from++;
+        }
+    }
+  return dst == dst_end;
+}
+
+/* Returns a hash of the 3 bytes at P. */
+static unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t x = p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16);
+  return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes the CNT literal bytes at SRC to DST, which ends at
+   DST_END, and returns the end of what was written, or a null
+   pointer if they do not fit. */
+static uint8_t *
+put_literals (uint8_t *dst, uint8_t *dst_end, const uint8_t *src, size_t cnt)
+{
+  while (cnt > 0)
+    {
+      size_t n = cnt < LZ_MAX_LITERALS ? cnt : LZ_MAX_LITERALS;
+
+      if ((size_t) (dst_end - dst) < n + 1)
+        return NULL;
+      *dst++ = n - 1;
+      memcpy (dst, src, n);
+      dst += n;
+      src += n;
+      cnt -= n;
+    }
+  return dst;
+}
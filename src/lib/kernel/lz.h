@@ -0,0 +1,20 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Fast LZ77-style compression of small buffers, such as pages. */
+
+/* Largest buffer that can be compressed. */
+#define LZ_MAX_SIZE 65536
+
+/* Bytes of scratch memory that lz_compress() needs. */
+#define LZ_WORK_SIZE 4096
+
+size_t lz_compress (const void *src, size_t size, void *dst,
+                    size_t dst_size, void *work);
+bool lz_decompress (const void *src, size_t size, void *dst,
+                    size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
@@ -0,0 +1,66 @@
+#ifndef __LIB_RING_H
+#define __LIB_RING_H
+
+#include <stdint.h>
+
+/* A system call ring: two pages that a process shares with the
+   kernel, set up by ring_setup().  The process queues requests
+   on the submission queue in the first page, and one
+   ring_enter() call carries out all of them, posting a result
+   for each on the completion queue in the second page.
+
+   Each queue is a circular buffer of RING_ENTRIES entries.  Its
+   producer writes the entry at TAIL % RING_ENTRIES and then
+   increments TAIL; its consumer reads the entry at HEAD %
+   RING_ENTRIES and then increments HEAD.  The process produces
+   submissions and consumes completions; the kernel does the
+   reverse.  HEAD and TAIL only ever increase, wrapping at 2**32,
+   so TAIL - HEAD is the number of entries queued. */
+
+/* Entries in each queue.  A power of 2. */
+#define RING_ENTRIES 128
+
+/* Operations a submission may request. */
+enum ring_op
+  {
+    RING_READ,                  /* read (fd, buf, len). */
+    RING_WRITE,                 /* write (fd, buf, len). */
+    RING_OPEN,                  /* open (buf). */
+    RING_CLOSE,                 /* close (fd). */
+    RING_SEEK                   /* seek (fd, len). */
+  };
+
+/* A request on the submission queue. */
+struct ring_sqe
+  {
+    uint32_t op;                /* A RING_* operation. */
+    int fd;                     /* File descriptor. */
+    void *buf;                  /* Buffer, or file name for RING_OPEN. */
+    uint32_t len;               /* Bytes, or position for RING_SEEK. */
+    uint32_t user_data;         /* Copied to the completion. */
+  };
+
+/* A result on the completion queue. */
+struct ring_cqe
+  {
+    uint32_t user_data;         /* From the submission. */
+    int32_t res;                /* What the system call returned. */
+  };
+
+/* The submission queue, in the first page of a ring. */
+struct ring_sq
+  {
+    uint32_t head;              /* Advanced by the kernel. */
+    uint32_t tail;              /* Advanced by the process. */
+    struct ring_sqe entries[RING_ENTRIES];
+  };
+
+/* The completion queue, in the second page of a ring. */
+struct ring_cq
+  {
+    uint32_t head;              /* Advanced by the process. */
+    uint32_t tail;              /* Advanced by the kernel. */
+    struct ring_cqe entries[RING_ENTRIES];
+  };
+
+#endif /* lib/ring.h */
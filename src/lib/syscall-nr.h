@@ -28,7 +28,23 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FORK,                   /* Duplicate this process. */
+    SYS_FAULT_STATS,            /* Get page fault statistics. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_RING_SETUP,             /* Set up a system call ring. */
+    SYS_RING_ENTER,             /* Carry out queued ring requests. */
+    SYS_COPY_FILE_RANGE,        /* Copy data from one file to another. */
+    SYS_AIO_READ,               /* Start reading from a file. */
+    SYS_AIO_WRITE,              /* Start writing to a file. */
+    SYS_AIO_POLL,               /* Check whether async I/O is done. */
+    SYS_AIO_WAIT,               /* Wait for async I/O to finish. */
+    SYS_TRACE                   /* Turn system call tracing on or off. */
   };
 
 #endif /* lib/syscall-nr.h */
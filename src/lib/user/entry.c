@@ -6,5 +6,6 @@ void _start (int argc, char *argv[]);
 void
 _start (int argc, char *argv[]) 
 {
+  syscall_init_entry ();
   exit (main (argc, argv));
 }
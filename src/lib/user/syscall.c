@@ -1,31 +1,52 @@
 #include <syscall.h>
+#include <cpuid.h>
 #include "../syscall-nr.h"
 
+/* Enter the kernel by SYSENTER rather than int $0x30?  Set by
+   syscall_init_entry() if the CPU supports it. */
+bool syscall_sysenter;
+
+/* Traps into the kernel for the system call whose number and
+   arguments are on top of the stack, by SYSENTER if
+   syscall_sysenter is true, otherwise by int $0x30.  SYSENTER
+   passes the kernel the stack pointer in ECX and the address to
+   return to in EDX, which the kernel doesn't preserve.  See
+   userprog/sysenter.S. */
+#define SYSCALL_TRAP                                            \
+        "cmpb $0, syscall_sysenter; je 1f; "                    \
+        "movl $2f, %%edx; movl %%esp, %%ecx; sysenter; "        \
+        "1: int $0x30; 2: "
+
+/* Registers that SYSCALL_TRAP may change, besides EAX. */
+#define SYSCALL_CLOBBERS "ecx", "edx", "cc", "memory"
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
           asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
+            ("pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $4, %%esp"                                   \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+               : SYSCALL_CLOBBERS);                             \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP    \
+             "addl $8, %%esp"                                   \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0)                              \
+               : SYSCALL_CLOBBERS);                             \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -35,12 +56,13 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $12, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1)                              \
-               : "memory");                                     \
+               : SYSCALL_CLOBBERS);                             \
           retval;                                               \
         })
 
@@ -51,16 +73,44 @@
           int retval;                                           \
           asm volatile                                          \
             ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
+             "pushl %[number]; " SYSCALL_TRAP                   \
+             "addl $16, %%esp"                                  \
                : "=a" (retval)                                  \
                : [number] "i" (NUMBER),                         \
                  [arg0] "g" (ARG0),                             \
                  [arg1] "g" (ARG1),                             \
                  [arg2] "g" (ARG2)                              \
-               : "memory");                                     \
+               : SYSCALL_CLOBBERS);                             \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2, and
+   ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          asm volatile                                          \
+            ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "    \
+             "pushl %[arg0]; pushl %[number]; " SYSCALL_TRAP    \
+             "addl $20, %%esp"                                  \
+               : "=a" (retval)                                  \
+               : [number] "i" (NUMBER),                         \
+                 [arg0] "g" (ARG0),                             \
+                 [arg1] "g" (ARG1),                             \
+                 [arg2] "g" (ARG2),                             \
+                 [arg3] "g" (ARG3)                              \
+               : SYSCALL_CLOBBERS);                             \
           retval;                                               \
         })
 
+/* Chooses how to enter the kernel for system calls.  Called at
+   startup, before any system call. */
+void
+syscall_init_entry (void) 
+{
+  syscall_sysenter = cpu_has_sysenter ();
+}
+
 void
 halt (void) 
 {
@@ -182,3 +232,87 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+void
+get_fault_stats (struct fault_stats *stats)
+{
+  syscall1 (SYS_FAULT_STATS, stats);
+}
+
+int
+pread (int fd, void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, length, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+ring_setup (void *addr)
+{
+  return syscall1 (SYS_RING_SETUP, addr);
+}
+
+int
+ring_enter (void)
+{
+  return syscall0 (SYS_RING_ENTER);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned length)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
+
+int
+aio_read (int fd, void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_AIO_READ, fd, buffer, length, offset);
+}
+
+int
+aio_write (int fd, const void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_AIO_WRITE, fd, buffer, length, offset);
+}
+
+int
+aio_poll (int id)
+{
+  return syscall1 (SYS_AIO_POLL, id);
+}
+
+int
+aio_wait (int id)
+{
+  return syscall1 (SYS_AIO_WAIT, id);
+}
+
+unsigned
+trace (bool on)
+{
+  return syscall1 (SYS_TRACE, on);
+}
@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <fault-stats.h>
+#include <iovec.h>
+#include <ring.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,22 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+extern bool syscall_sysenter;
+void syscall_init_entry (void);
+pid_t fork (void);
+void get_fault_stats (struct fault_stats *);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int ring_setup (void *addr);
+int ring_enter (void);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+int aio_read (int fd, void *buffer, unsigned length, unsigned offset);
+int aio_write (int fd, const void *buffer, unsigned length, unsigned offset);
+int aio_poll (int id);
+int aio_wait (int id);
+unsigned trace (bool on);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,60 @@
+/* Starts several asynchronous reads of a file at once, waits for
+   them out of order, then writes a copy of the file
+   asynchronously and reads it back. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PIECES 4
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t piece = size / PIECES;
+  char buf[sizeof sample];
+  int ids[PIECES];
+  int in_fd, out_fd, id;
+  int i;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  /* Keep all the pieces in flight at once. */
+  memset (buf, 0, sizeof buf);
+  for (i = 0; i < PIECES; i++)
+    {
+      size_t ofs = i * piece;
+      size_t len = i < PIECES - 1 ? piece : size - ofs;
+      if ((ids[i] = aio_read (in_fd, buf + ofs, len, ofs)) < 0)
+        fail ("aio_read #%d failed", i);
+    }
+  msg ("started %d reads", PIECES);
+  for (i = PIECES - 1; i >= 0; i--)
+    {
+      int result = aio_wait (ids[i]);
+      if (result != (int) (i < PIECES - 1 ? piece : size - i * piece))
+        fail ("aio_wait #%d returned %d", i, result);
+    }
+  msg ("waited for all reads");
+  if (memcmp (buf, sample, size))
+    fail ("reads returned wrong data");
+  CHECK (tell (in_fd) == 0, "position unchanged");
+  CHECK (aio_wait (ids[0]) == -1, "second wait fails");
+  CHECK (aio_poll (12345) == -1, "poll of bad id fails");
+
+  CHECK (create ("copy.txt", size), "create \"copy.txt\"");
+  CHECK ((out_fd = open ("copy.txt")) > 1, "open \"copy.txt\"");
+  CHECK ((id = aio_write (out_fd, sample, size, 0)) >= 0, "aio_write");
+  while (aio_poll (id) == 0)
+    continue;
+  CHECK (aio_poll (id) == 1, "poll reports write done");
+  CHECK (aio_wait (id) == (int) size, "wait for write");
+
+  memset (buf, 0, sizeof buf);
+  CHECK (read (out_fd, buf, size) == (int) size, "read \"copy.txt\"");
+  if (memcmp (buf, sample, size))
+    fail ("write stored wrong data");
+}
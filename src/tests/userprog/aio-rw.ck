@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-rw) begin
+(aio-rw) open "sample.txt"
+(aio-rw) started 4 reads
+(aio-rw) waited for all reads
+(aio-rw) position unchanged
+(aio-rw) second wait fails
+(aio-rw) poll of bad id fails
+(aio-rw) create "copy.txt"
+(aio-rw) open "copy.txt"
+(aio-rw) aio_write
+(aio-rw) poll reports write done
+(aio-rw) wait for write
+(aio-rw) read "copy.txt"
+(aio-rw) end
+aio-rw: exit(0)
+EOF
+pass;
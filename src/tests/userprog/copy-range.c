@@ -0,0 +1,35 @@
+/* Copies a file to another with copy_file_range(), in a short
+   unaligned piece and then the rest, and checks the result and
+   both file positions. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  int in_fd, out_fd;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy.txt", size), "create \"copy.txt\"");
+  CHECK ((out_fd = open ("copy.txt")) > 1, "open \"copy.txt\"");
+
+  CHECK (copy_file_range (in_fd, out_fd, 7) == 7, "copy 7 bytes");
+  CHECK (copy_file_range (in_fd, out_fd, 4096) == (int) (size - 7),
+         "copy the rest");
+  CHECK (tell (in_fd) == size && tell (out_fd) == size,
+         "both positions advanced");
+  CHECK (copy_file_range (in_fd, out_fd, 10) == 0, "copy at end of file");
+  CHECK (copy_file_range (in_fd, 100, 10) == -1, "copy to bad fd");
+
+  seek (out_fd, 0);
+  memset (buf, 0, sizeof buf);
+  CHECK (read (out_fd, buf, size) == (int) size, "read \"copy.txt\"");
+  if (memcmp (buf, sample, size))
+    fail ("copy has wrong data");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) open "sample.txt"
+(copy-range) create "copy.txt"
+(copy-range) open "copy.txt"
+(copy-range) copy 7 bytes
+(copy-range) copy the rest
+(copy-range) both positions advanced
+(copy-range) copy at end of file
+(copy-range) copy to bad fd
+(copy-range) read "copy.txt"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,27 @@
+/* Opens a file many times, closes one of the descriptors, and
+   checks that the next open reuses the lowest free one. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 40
+
+void
+test_main (void) 
+{
+  int fds[OPEN_CNT];
+  int i, fd;
+
+  for (i = 0; i < OPEN_CNT; i++)
+    if ((fds[i] = open ("sample.txt")) < 2)
+      fail ("open #%d returned %d", i, fds[i]);
+  msg ("opened \"sample.txt\" %d times", OPEN_CNT);
+
+  close (fds[5]);
+  close (fds[20]);
+  CHECK ((fd = open ("sample.txt")) == fds[5],
+         "reopen gets lowest free descriptor");
+  CHECK ((fd = open ("sample.txt")) == fds[20],
+         "next reopen gets the other one");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-reuse) begin
+(open-reuse) opened "sample.txt" 40 times
+(open-reuse) reopen gets lowest free descriptor
+(open-reuse) next reopen gets the other one
+(open-reuse) end
+open-reuse: exit(0)
+EOF
+pass;
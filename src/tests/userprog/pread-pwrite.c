@@ -0,0 +1,36 @@
+/* Writes and reads a file at explicit offsets with pwrite() and
+   pread(), and checks that neither moves the file position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  size_t half = size / 2;
+  char buf[sizeof sample];
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  /* Write the back half first, then the front half. */
+  CHECK (pwrite (handle, sample + half, size - half, half)
+         == (int) (size - half), "pwrite back half");
+  CHECK (pwrite (handle, sample, half, 0) == (int) half,
+         "pwrite front half");
+  CHECK (tell (handle) == 0, "position unchanged by pwrite");
+
+  memset (buf, 0, sizeof buf);
+  CHECK (pread (handle, buf, size, 0) == (int) size, "pread whole file");
+  if (memcmp (buf, sample, size))
+    fail ("pread returned wrong data");
+  CHECK (pread (handle, buf, size, half) == (int) (size - half),
+         "pread stops at end of file");
+  CHECK (tell (handle) == 0, "position unchanged by pread");
+  CHECK (pread (handle, buf, 1, -1) == -1, "pread at negative offset");
+}
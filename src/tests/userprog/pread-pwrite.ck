@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "test.txt"
+(pread-pwrite) open "test.txt"
+(pread-pwrite) pwrite back half
+(pread-pwrite) pwrite front half
+(pread-pwrite) position unchanged by pwrite
+(pread-pwrite) pread whole file
+(pread-pwrite) pread stops at end of file
+(pread-pwrite) position unchanged by pread
+(pread-pwrite) pread at negative offset
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Gathers a file's contents from three buffers with writev(),
+   scatters it back into three others with readv(), and writes
+   one line to the console with writev(). */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char a[10], b[sizeof sample], c[20];
+  struct iovec iov[3];
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 10;
+  iov[2].iov_len = size - 10;
+  CHECK (writev (handle, iov, 3) == (int) size, "writev three buffers");
+
+  seek (handle, 0);
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof a;
+  iov[1].iov_base = b;
+  iov[1].iov_len = size - sizeof a - sizeof c;
+  iov[2].iov_base = c;
+  iov[2].iov_len = sizeof c;
+  CHECK (readv (handle, iov, 3) == (int) size, "readv three buffers");
+  if (memcmp (a, sample, sizeof a)
+      || memcmp (b, sample + sizeof a, size - sizeof a - sizeof c)
+      || memcmp (c, sample + size - sizeof c, sizeof c))
+    fail ("readv returned wrong data");
+  CHECK (tell (handle) == size, "readv advanced position");
+  CHECK (readv (handle, iov, -1) == -1, "readv with negative count");
+
+  iov[0].iov_base = "(readv-writev) console ";
+  iov[0].iov_len = strlen (iov[0].iov_base);
+  iov[1].iov_base = "writev\n";
+  iov[1].iov_len = strlen (iov[1].iov_base);
+  writev (STDOUT_FILENO, iov, 2);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "test.txt"
+(readv-writev) open "test.txt"
+(readv-writev) writev three buffers
+(readv-writev) readv three buffers
+(readv-writev) readv advanced position
+(readv-writev) readv with negative count
+(readv-writev) console writev
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
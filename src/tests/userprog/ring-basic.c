@@ -0,0 +1,91 @@
+/* Opens, writes, seeks, reads back, and closes a file through a
+   system call ring, with one ring_enter() call for the first
+   three requests and another for the last two.  Then reads the
+   file into a buffer inside the ring's own pages, both through
+   the ring and with read(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RING_ADDR ((uint8_t *) 0x10000000)
+
+static struct ring_sq *sq = (struct ring_sq *) RING_ADDR;
+static struct ring_cq *cq = (struct ring_cq *) (RING_ADDR + 4096);
+
+/* Buffer in the unused end of the ring's second page. */
+static char *ring_buf = (char *) (RING_ADDR + 2 * 4096 - 512);
+
+/* Queues a request on the ring. */
+static void
+submit (enum ring_op op, int fd, void *buf, uint32_t len, uint32_t user_data)
+{
+  struct ring_sqe *sqe = &sq->entries[sq->tail % RING_ENTRIES];
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->user_data = user_data;
+  sq->tail++;
+}
+
+/* Takes the next completion off the ring, checks that it is for
+   USER_DATA, and returns its result. */
+static int
+reap (uint32_t user_data)
+{
+  struct ring_cqe *cqe = &cq->entries[cq->head % RING_ENTRIES];
+  if (cq->head == cq->tail)
+    fail ("completion queue empty");
+  if (cqe->user_data != user_data)
+    fail ("completion for %u instead of %u", cqe->user_data, user_data);
+  cq->head++;
+  return cqe->res;
+}
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  int fd;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK (ring_setup (RING_ADDR) == 0, "ring_setup");
+  CHECK (ring_setup (RING_ADDR) == -1, "second ring_setup fails");
+
+  /* The file's first descriptor will be 2, since nothing else
+     is open. */
+  submit (RING_OPEN, 0, "test.txt", 0, 1);
+  submit (RING_WRITE, 2, sample, size, 2);
+  submit (RING_SEEK, 2, NULL, 0, 3);
+  CHECK (ring_enter () == 3, "ring_enter carries out 3 requests");
+  CHECK ((fd = reap (1)) == 2, "open completion");
+  CHECK (reap (2) == (int) size, "write completion");
+  CHECK (reap (3) == 0, "seek completion");
+
+  memset (buf, 0, sizeof buf);
+  submit (RING_READ, fd, buf, size, 4);
+  submit (RING_CLOSE, fd, NULL, 0, 5);
+  CHECK (ring_enter () == 2, "ring_enter carries out 2 requests");
+  CHECK (reap (4) == (int) size, "read completion");
+  CHECK (reap (5) == 0, "close completion");
+  if (memcmp (buf, sample, size))
+    fail ("read back wrong data");
+  CHECK (ring_enter () == 0, "ring_enter with empty queue");
+
+  CHECK ((fd = open ("test.txt")) > 1, "open \"test.txt\"");
+  submit (RING_READ, fd, ring_buf, size, 6);
+  CHECK (ring_enter () == 1, "ring_enter reads into ring page");
+  CHECK (reap (6) == (int) size, "ring page read completion");
+  if (memcmp (ring_buf, sample, size))
+    fail ("ring read into ring page read back wrong data");
+  memset (ring_buf, 0, size);
+  seek (fd, 0);
+  CHECK (read (fd, ring_buf, size) == (int) size, "read into ring page");
+  if (memcmp (ring_buf, sample, size))
+    fail ("read into ring page read back wrong data");
+  close (fd);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(ring-basic) begin
+(ring-basic) create "test.txt"
+(ring-basic) ring_setup
+(ring-basic) second ring_setup fails
+(ring-basic) ring_enter carries out 3 requests
+(ring-basic) open completion
+(ring-basic) write completion
+(ring-basic) seek completion
+(ring-basic) ring_enter carries out 2 requests
+(ring-basic) read completion
+(ring-basic) close completion
+(ring-basic) ring_enter with empty queue
+(ring-basic) open "test.txt"
+(ring-basic) ring_enter reads into ring page
+(ring-basic) ring page read completion
+(ring-basic) read into ring page
+(ring-basic) end
+ring-basic: exit(0)
+EOF
+pass;
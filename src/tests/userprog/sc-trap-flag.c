@@ -0,0 +1,38 @@
+/* Sets the trap flag in EFLAGS just before entering the kernel
+   by SYSENTER for a write() system call.  SYSENTER does not
+   clear the trap flag, so the kernel takes a single-step debug
+   exception on its first instruction.  It must clear the flag
+   and carry out the call instead of panicking, and return with
+   the flag clear.  If the CPU lacks SYSENTER, makes the same
+   call the usual way, because int $0x30 clears the flag by
+   itself. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char text[] = "(sc-trap-flag) written with the trap flag set\n";
+
+void
+test_main (void) 
+{
+  int retval;
+
+  if (syscall_sysenter)
+    asm volatile
+      ("pushl %[size]; pushl %[buf]; pushl %[fd]; pushl %[number]; "
+       "pushfl; orl %[tf], (%%esp); "
+       "movl $1f, %%edx; leal 4(%%esp), %%ecx; "
+       "popfl; sysenter; "
+       "1: addl $16, %%esp"
+       : "=a" (retval)
+       : [number] "i" (SYS_WRITE), [fd] "i" (STDOUT_FILENO),
+         [buf] "r" (text), [size] "r" (sizeof text - 1),
+         [tf] "i" (0x100)       /* EFLAGS trap flag. */
+       : "ecx", "edx", "cc", "memory");
+  else
+    retval = write (STDOUT_FILENO, text, sizeof text - 1);
+  CHECK (retval == (int) sizeof text - 1, "write returned its length");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(sc-trap-flag) begin
+(sc-trap-flag) written with the trap flag set
+(sc-trap-flag) write returned its length
+(sc-trap-flag) end
+sc-trap-flag: exit(0)
+EOF
+pass;
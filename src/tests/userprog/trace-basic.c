@@ -0,0 +1,28 @@
+/* Turns on system call tracing, which also turns on profiling,
+   and checks that system calls still work and that exactly the
+   traced ones are recorded, then exits with tracing still on. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[16];
+  unsigned start, traced;
+  int handle;
+
+  start = trace (true);
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, sizeof buf) == sizeof buf, "read \"sample.txt\"");
+
+  /* open(), read(), and this trace() itself. */
+  traced = trace (false);
+  CHECK (traced - start == 3, "traced 3 calls");
+  CHECK (filesize (handle) == sizeof sample - 1, "filesize untraced");
+  CHECK (trace (true) == traced, "untraced calls not recorded");
+  close (handle);
+  msg ("closed \"sample.txt\"");
+}
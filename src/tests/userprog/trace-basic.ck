@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(trace-basic) begin
+(trace-basic) open "sample.txt"
+(trace-basic) read "sample.txt"
+(trace-basic) traced 3 calls
+(trace-basic) filesize untraced
+(trace-basic) untraced calls not recorded
+(trace-basic) closed "sample.txt"
+(trace-basic) end
+trace-basic: exit(0)
+EOF
+pass;
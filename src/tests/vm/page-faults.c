@@ -0,0 +1,32 @@
+/* Writes every page of a zeroed array and checks that the page
+   fault statistics returned by get_fault_stats() account for
+   them. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGES 64
+#define PAGE 4096
+
+static char buf[PAGES * PAGE];
+
+void
+test_main (void)
+{
+  struct fault_stats before, after;
+  size_t i;
+
+  get_fault_stats (&before);
+  for (i = 0; i < sizeof buf; i += PAGE)
+    buf[i] = 1;
+  get_fault_stats (&after);
+  msg ("wrote %d pages", PAGES);
+
+  CHECK (after.zero - before.zero >= PAGES,
+         "at least %d pages zero-filled", PAGES);
+  CHECK (after.not_present > before.not_present,
+         "faults on pages not present counted");
+  CHECK (after.cycles > before.cycles, "fault handling time counted");
+  CHECK (after.ws_peak >= after.ws_pages, "working set peak");
+}
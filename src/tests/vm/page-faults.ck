@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-faults) begin
+(page-faults) wrote 64 pages
+(page-faults) at least 64 pages zero-filled
+(page-faults) faults on pages not present counted
+(page-faults) fault handling time counted
+(page-faults) working set peak
+(page-faults) end
+EOF
+pass;
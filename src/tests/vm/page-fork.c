@@ -0,0 +1,57 @@
+/* Forks a process with a 2 MB data area and checks that parent
+   and child each see their own copy of it once either one
+   writes, and that the child inherits the parent's open files
+   at the same position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+
+static char buf[SIZE];
+
+/* Returns true if every page of BUF starts with C. */
+static bool
+all_pages (char c)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i += 4096)
+    if (buf[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  int handle;
+  char c;
+
+  memset (buf, 'p', SIZE);
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  child = fork ();
+  if (child == 0)
+    {
+      if (!all_pages ('p'))
+        fail ("child does not see parent's data");
+      memset (buf, 'c', SIZE);
+      if (!all_pages ('c'))
+        fail ("child does not see its own writes");
+      if (read (handle, &c, 1) != 1 || c != sample[0])
+        fail ("child cannot read inherited file");
+      exit (81);
+    }
+  if (child < 0)
+    fail ("fork failed");
+
+  CHECK (wait (child) == 81, "wait for child");
+  CHECK (all_pages ('p'), "parent's copy intact");
+  CHECK (read (handle, &c, 1) == 1 && c == sample[0],
+         "read inherited file from the start");
+}
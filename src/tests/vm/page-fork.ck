@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(page-fork) begin
+(page-fork) open "sample.txt"
+page-fork: exit(81)
+(page-fork) wait for child
+(page-fork) parent's copy intact
+(page-fork) read inherited file from the start
+(page-fork) end
+page-fork: exit(0)
+EOF
+pass;
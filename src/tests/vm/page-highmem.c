@@ -0,0 +1,39 @@
+/* Fills 80 MB of memory, more than the kernel maps directly, and
+   verifies that every page kept its contents.  Run with enough
+   RAM that the pages beyond 64 MB come from high memory. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (80 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+static uint32_t buf[SIZE / sizeof (uint32_t)];
+
+/* Returns the value stored in word I of BUF. */
+static uint32_t
+pattern (size_t i) 
+{
+  return i * 2654435761u;
+}
+
+void
+test_main (void)
+{
+  const size_t words_per_page = PAGE_SIZE / sizeof *buf;
+  size_t i;
+
+  /* Write every word of every page. */
+  msg ("fill");
+  for (i = 0; i < sizeof buf / sizeof *buf; i++)
+    buf[i] = pattern (i);
+
+  /* Read it all back. */
+  msg ("verify");
+  for (i = 0; i < sizeof buf / sizeof *buf; i++)
+    if (buf[i] != pattern (i))
+      fail ("page %zu word %zu is %#"PRIx32", expected %#"PRIx32,
+            i / words_per_page, i % words_per_page, buf[i], pattern (i));
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-highmem) begin
+(page-highmem) fill
+(page-highmem) verify
+(page-highmem) end
+EOF
+pass;
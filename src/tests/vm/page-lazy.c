@@ -0,0 +1,28 @@
+/* Runs a program whose data segment is much bigger than physical
+   memory but touches only a few pages of it.  This only works if
+   pages are loaded when they are first used, not at exec time. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024 * 1024)
+
+static char zeros[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < 8; i++)
+    {
+      char *p = zeros + i * (SIZE / 8);
+      if (*p != 0)
+        fail ("zeros[%zu] is %d", (size_t) (p - zeros), *p);
+      *p = i;
+    }
+  for (i = 0; i < 8; i++)
+    if (zeros[i * (SIZE / 8)] != (char) i)
+      fail ("zeros[%zu] lost its value", i * (SIZE / 8));
+  msg ("touched 8 pages");
+}
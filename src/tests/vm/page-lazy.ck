@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-lazy) begin
+(page-lazy) touched 8 pages
+(page-lazy) end
+EOF
+pass;
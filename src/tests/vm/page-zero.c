@@ -0,0 +1,29 @@
+/* Reads every page of a data segment much bigger than physical
+   memory, which must all read as zeros, then writes a few pages
+   and checks that only those changed. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024 * 1024)
+#define PAGE 4096
+
+static char zeros[SIZE];
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i += PAGE)
+    if (zeros[i] != 0)
+      fail ("zeros[%zu] is %d before any write", i, zeros[i]);
+  msg ("read %d pages of zeros", SIZE / PAGE);
+
+  for (i = 0; i < SIZE; i += SIZE / 8)
+    zeros[i + 1] = 1;
+  for (i = 0; i < SIZE; i += PAGE)
+    if (zeros[i + 1] != (i % (SIZE / 8) == 0))
+      fail ("zeros[%zu] is %d after writes", i + 1, zeros[i + 1]);
+  msg ("wrote 8 pages");
+}
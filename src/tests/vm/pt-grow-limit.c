@@ -0,0 +1,17 @@
+/* Grows the stack to 7 MB, which must work, and then tries to
+   grow it to 9 MB, past the default 8 MB limit.  The process
+   must be terminated with -1 exit code. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  asm volatile ("movl %%esp, %%eax; subl $0x700000, %%esp; "
+                "pushl $0; movl %%eax, %%esp" : : : "eax", "memory");
+  msg ("grew stack to 7 MB");
+  asm volatile ("movl %%esp, %%eax; subl $0x900000, %%esp; "
+                "pushl $0; movl %%eax, %%esp" : : : "eax", "memory");
+  fail ("grew stack past 8 MB");
+}
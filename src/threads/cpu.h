@@ -0,0 +1,63 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+#include <stdint.h>
+
+/* Helpers for x86 control registers and special instructions
+   that have no port I/O counterpart in io.h. */
+
+/* Flags in control register 4. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions (4 MB pages). */
+#define CR4_PGE 0x00000080      /* Page Global Enable. */
+
+/* Returns the value of control register 4.
+   See [IA32-v2a] "MOV--Move to/from Control Registers". */
+static inline uint32_t
+read_cr4 (void)
+{
+  uint32_t cr4;
+  asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+  return cr4;
+}
+
+/* Stores CR4 into control register 4. */
+static inline void
+write_cr4 (uint32_t cr4)
+{
+  asm volatile ("movl %0, %%cr4" : : "r" (cr4) : "memory");
+}
+
+/* Removes the TLB entry, if any, that translates virtual address
+   VADDR.  Unlike a CR3 reload, this also drops global entries.
+   See [IA32-v2a] "INVLPG". */
+static inline void
+invlpg (const void *vaddr)
+{
+  asm volatile ("invlpg (%0)" : : "r" (vaddr) : "memory");
+}
+
+/* Model-specific registers that set up SYSENTER.
+   See [IA32-v3a] 4.8.7 "Fast System Calls". */
+#define MSR_SYSENTER_CS  0x174  /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Stores VALUE into model-specific register MSR.
+   See [IA32-v2b] "WRMSR". */
+static inline void
+wrmsr (uint32_t msr, uint64_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "A" (value));
+}
+
+/* Returns the processor's time-stamp counter, which counts
+   clock cycles since reset.  See [IA32-v2b] "RDTSC". */
+static inline uint64_t
+rdtsc (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+#endif /* threads/cpu.h */
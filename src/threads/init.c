@@ -15,17 +15,22 @@
 #include "devices/timer.h"
 #include "devices/vga.h"
 #include "devices/rtc.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/kmap.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/aio.h"
 #include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
 #else
@@ -36,6 +41,12 @@
 #include "devices/ide.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
+#endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
 #endif
 
 /* Page directory with kernel mappings only. */
@@ -54,7 +65,7 @@ static const char *swap_bdev_name;
 #endif
 #endif /* FILESYS */
 
-/* -ul: Maximum number of pages to put into palloc's user pool. */
+/* -ul: Maximum number of pages palloc may give to user pages. */
 static size_t user_page_limit = SIZE_MAX;
 
 static void bss_init (void);
@@ -92,7 +103,7 @@ main (void)
 
   /* Greet user. */
   printf ("Pintos booting with %'"PRIu32" kB RAM...\n",
-          init_ram_pages * PGSIZE / 1024);
+          (init_ram_pages + init_high_pages) * (PGSIZE / 1024));
 
   /* Initialize memory system. */
   palloc_init (user_page_limit);
@@ -127,6 +138,19 @@ main (void)
   filesys_init (format_filesys);
 #endif
 
+#ifdef USERPROG
+  /* Start the asynchronous I/O workers. */
+  aio_init ();
+#endif
+
+#ifdef VM
+  /* Initialize virtual memory.  Swap comes first because
+     frame_init() starts the pageout daemon. */
+  swap_init ();
+  frame_init ();
+  page_init ();
+#endif
+
   printf ("Boot complete.\n");
   
   /* Run actions specified on kernel command line. */
@@ -153,7 +177,13 @@ bss_init (void)
 /* Populates the base page directory and page table with the
    kernel virtual mapping, and then sets up the CPU to use the
    new page directory.  Points init_page_dir to the page
-   directory it creates. */
+   directory it creates.
+
+   Every 4 MB region of RAM that contains no kernel text is
+   mapped with a single large page, and everything is marked
+   global, so that kernel TLB entries survive the CR3 reload on
+   each process switch.  The region holding the kernel text
+   still uses 4 kB pages so that the text can be read-only. */
 static void
 paging_init (void)
 {
@@ -163,7 +193,7 @@ paging_init (void)
 
   pd = init_page_dir = palloc_get_page (PAL_ASSERT | PAL_ZERO);
   pt = NULL;
-  for (page = 0; page < init_ram_pages; page++)
+  for (page = 0; page < init_ram_pages; )
     {
       uintptr_t paddr = page * PGSIZE;
       char *vaddr = ptov (paddr);
@@ -171,15 +201,29 @@ paging_init (void)
       size_t pte_idx = pt_no (vaddr);
       bool in_kernel_text = &_start <= vaddr && vaddr < &_end_kernel_text;
 
+      if (pte_idx == 0 && page + PTSPAN / PGSIZE <= init_ram_pages
+          && (vaddr + PTSPAN <= &_start || vaddr >= &_end_kernel_text))
+        {
+          pd[pde_idx] = pde_create_kernel_large (vaddr, true);
+          page += PTSPAN / PGSIZE;
+          continue;
+        }
+
       if (pd[pde_idx] == 0)
         {
           pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
           pd[pde_idx] = pde_create (pt);
         }
 
-      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text);
+      pt[pte_idx] = pte_create_kernel (vaddr, !in_kernel_text) | PTE_G;
+      page++;
     }
 
+  /* High memory is reached through the kmap window, whose page
+     table has to exist before any process's page directory
+     copies ours. */
+  kmap_init (pd);
+
   /* Store the physical address of the page directory into CR3
      aka PDBR (page directory base register).  This activates our
      new page tables immediately.  See [IA32-v2a] "MOV--Move
@@ -259,6 +303,22 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-scstat"))
+        syscall_profile = true;
+      else if (!strcmp (name, "-sctrace"))
+        syscall_profile = syscall_trace_all = true;
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-stk"))
+        page_stack_max = (size_t) atoi (value) * 1024 * 1024;
+      else if (!strcmp (name, "-lwm"))
+        frame_low_wm = atoi (value);
+      else if (!strcmp (name, "-hwm"))
+        frame_high_wm = atoi (value);
+      else if (!strcmp (name, "-zswap"))
+        swap_zswap_pages = atoi (value);
+      else if (!strcmp (name, "-faults"))
+        page_report_faults = true;
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -292,6 +352,154 @@ run_task (char **argv)
   printf ("Execution of '%s' complete.\n", task);
 }
 
+/* Prints memory usage statistics. */
+static void
+run_stats (char **argv UNUSED)
+{
+  palloc_print_stats ();
+#ifdef VM
+  frame_print_stats ();
+  swap_print_stats ();
+#endif
+#ifdef USERPROG
+  syscall_print_stats ();
+  aio_print_stats ();
+#endif
+#ifdef FILESYS
+  inode_print_stats ();
+#endif
+}
+
+#ifdef USERPROG
+/* Prints the latest system calls traced under "-sctrace" or by
+   processes that called trace(). */
+static void
+run_sctrace (char **argv UNUSED)
+{
+  syscall_dump_trace ();
+}
+#endif
+
+#ifdef USERPROG
+/* Number of round trips timed by the bench-switch action. */
+#define SWITCH_BENCH_ROUNDS 10000
+
+/* Number of kernel pages read after every switch, so that the
+   cost of refilling kernel TLB entries is part of the timing. */
+#define SWITCH_BENCH_PAGES 64
+
+/* State shared by the two bench-switch threads. */
+struct switch_bench
+  {
+    struct semaphore ping;              /* Wakes the partner. */
+    struct semaphore pong;              /* Wakes the timing thread. */
+    struct semaphore done;              /* Upped as each thread ends. */
+    uint64_t cycles;                    /* Total TSC cycles measured. */
+  };
+
+/* Gives the running thread an empty user address space of its
+   own, so that switching to it reloads CR3 just like a switch
+   between two processes.  process_exit() frees it. */
+static void
+switch_bench_enter (void)
+{
+  struct thread *t = thread_current ();
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    PANIC ("bench-switch: out of memory");
+  process_activate ();
+}
+
+/* Reads one byte from each of the first SWITCH_BENCH_PAGES
+   pages of the kernel's mapping of physical memory. */
+static void
+switch_bench_touch (void)
+{
+  volatile uint8_t *p = ptov (0);
+  size_t i;
+
+  for (i = 0; i < SWITCH_BENCH_PAGES; i++)
+    p[i * PGSIZE];
+}
+
+/* Answers every ping from the timing thread with a pong. */
+static void
+switch_bench_partner (void *b_)
+{
+  struct switch_bench *b = b_;
+  int i;
+
+  switch_bench_enter ();
+  for (i = 0; i < SWITCH_BENCH_ROUNDS; i++)
+    {
+      sema_down (&b->ping);
+      switch_bench_touch ();
+      sema_up (&b->pong);
+    }
+  sema_up (&b->done);
+}
+
+/* Pings the partner thread and times the round trips. */
+static void
+switch_bench_timer (void *b_)
+{
+  struct switch_bench *b = b_;
+  uint64_t start;
+  int i;
+
+  switch_bench_enter ();
+  start = rdtsc ();
+  for (i = 0; i < SWITCH_BENCH_ROUNDS; i++)
+    {
+      sema_up (&b->ping);
+      sema_down (&b->pong);
+      switch_bench_touch ();
+    }
+  b->cycles = rdtsc () - start;
+  sema_up (&b->done);
+}
+
+/* Measures the cost of switching between two processes, first
+   with global pages disabled, so that every CR3 load also flushes
+   the kernel's TLB entries, and then with them enabled. */
+static void
+run_bench_switch (char **argv UNUSED)
+{
+  int pass;
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      bool global = pass == 1;
+      struct switch_bench b;
+      enum intr_level old_level;
+
+      /* Toggling CR4.PGE flushes the whole TLB, global
+         entries included. */
+      old_level = intr_disable ();
+      write_cr4 (global ? read_cr4 () | CR4_PGE : read_cr4 () & ~CR4_PGE);
+      intr_set_level (old_level);
+
+      sema_init (&b.ping, 0);
+      sema_init (&b.pong, 0);
+      sema_init (&b.done, 0);
+      b.cycles = 0;
+      if (thread_create ("bench-pong", PRI_DEFAULT,
+                         switch_bench_partner, &b) == TID_ERROR
+          || thread_create ("bench-ping", PRI_DEFAULT,
+                            switch_bench_timer, &b) == TID_ERROR)
+        PANIC ("bench-switch: thread creation failed");
+      sema_down (&b.done);
+      sema_down (&b.done);
+
+      printf ("bench-switch: global pages %s: %"PRIu64" cycles "
+              "per round trip (%d round trips)\n",
+              global ? "on" : "off",
+              b.cycles / SWITCH_BENCH_ROUNDS, SWITCH_BENCH_ROUNDS);
+    }
+}
+#endif
+
 /* Executes all of the actions specified in ARGV[]
    up to the null pointer sentinel. */
 static void
@@ -309,6 +517,11 @@ run_actions (char **argv)
   static const struct action actions[] = 
     {
       {"run", 2, run_task},
+      {"stats", 1, run_stats},
+#ifdef USERPROG
+      {"bench-switch", 1, run_bench_switch},
+      {"sctrace", 1, run_sctrace},
+#endif
 #ifdef FILESYS
       {"ls", 1, fsutil_ls},
       {"cat", 2, fsutil_cat},
@@ -354,9 +567,13 @@ usage (void)
           "\nAvailable actions:\n"
 #ifdef USERPROG
           "  run 'PROG [ARG...]' Run PROG and wait for it to complete.\n"
+          "  bench-switch       Time process switches with and without\n"
+          "                     global kernel pages.\n"
+          "  sctrace            Print the latest traced system calls.\n"
 #else
           "  run TEST           Run TEST.\n"
 #endif
+          "  stats              Print memory usage statistics.\n"
 #ifdef FILESYS
           "  ls                 List files in the root directory.\n"
           "  cat FILE           Print FILE to the console.\n"
@@ -381,6 +598,15 @@ usage (void)
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -scstat            Profile system calls for `stats'.\n"
+          "  -sctrace           Also trace every process's system calls.\n"
+#endif
+#ifdef VM
+          "  -stk=MB            Limit user stacks to MB megabytes (default 8).\n"
+          "  -lwm=COUNT         Start paging out below COUNT free user frames.\n"
+          "  -hwm=COUNT         Stop paging out at COUNT free user frames.\n"
+          "  -zswap=COUNT       Keep COUNT pages of compressed swap (default 64).\n"
+          "  -faults            Print page fault statistics as processes exit.\n"
 #endif
           );
   shutdown_power_off ();
@@ -0,0 +1,95 @@
+#include "threads/kmap.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/cpu.h"
+#include "threads/loader.h"
+#include "threads/palloc.h"
+#include "threads/pte.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Number of frames that can be mapped at once. */
+#define KMAP_SLOTS (PTSPAN / PGSIZE)
+
+/* Page table for the kmap window.  A slot is free if its PTE is
+   zero.  Every page directory shares this page table, because
+   pagedir_create() copies the kernel's PDEs. */
+static uint32_t *kmap_pt;
+
+/* Protects kmap_pt. */
+static struct lock kmap_lock;
+
+/* Signaled when a slot is released. */
+static struct condition kmap_released;
+
+/* Slot at which to start looking for a free slot. */
+static size_t kmap_next;
+
+/* Creates the page table for the kmap window and installs it in
+   page directory PD, which must be the initial page directory.
+   Must be called before any other page directory is created. */
+void
+kmap_init (uint32_t *pd)
+{
+  kmap_pt = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  pd[pd_no (KMAP_BASE)] = pde_create (kmap_pt);
+  lock_init (&kmap_lock);
+  cond_init (&kmap_released);
+}
+
+/* Returns a kernel virtual address through which physical
+   FRAME can be accessed.  A frame in low memory is returned at
+   its permanent address.  A frame in high memory is mapped into
+   a free slot of the kmap window, waiting for one to be
+   released if necessary, and must be released with kunmap() as
+   soon as the caller is done with it. */
+void *
+kmap (uintptr_t frame)
+{
+  size_t slot;
+
+  ASSERT ((frame & PGMASK) == 0);
+  if (frame < (uintptr_t) init_ram_pages * PGSIZE)
+    return ptov (frame);
+
+  lock_acquire (&kmap_lock);
+  for (;;)
+    {
+      size_t i;
+
+      for (i = 0; i < KMAP_SLOTS; i++)
+        {
+          slot = (kmap_next + i) % KMAP_SLOTS;
+          if (kmap_pt[slot] == 0)
+            break;
+        }
+      if (i < KMAP_SLOTS)
+        break;
+      cond_wait (&kmap_released, &kmap_lock);
+    }
+  kmap_pt[slot] = frame | PTE_P | PTE_W;
+  kmap_next = (slot + 1) % KMAP_SLOTS;
+  lock_release (&kmap_lock);
+
+  return (uint8_t *) KMAP_BASE + slot * PGSIZE;
+}
+
+/* Releases KPAGE, which must have been returned by kmap().
+   Does nothing for frames in low memory. */
+void
+kunmap (void *kpage)
+{
+  size_t slot;
+
+  ASSERT (pg_ofs (kpage) == 0);
+  if (kpage < KMAP_BASE)
+    return;
+
+  slot = ((uint8_t *) kpage - (uint8_t *) KMAP_BASE) / PGSIZE;
+  lock_acquire (&kmap_lock);
+  ASSERT (kmap_pt[slot] != 0);
+  kmap_pt[slot] = 0;
+  invlpg (kpage);
+  cond_signal (&kmap_released, &kmap_lock);
+  lock_release (&kmap_lock);
+}
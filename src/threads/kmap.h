@@ -0,0 +1,20 @@
+#ifndef THREADS_KMAP_H
+#define THREADS_KMAP_H
+
+#include <stdint.h>
+
+/* Temporary kernel mappings for physical frames.
+
+   Low memory is mapped permanently at PHYS_BASE, but high memory
+   has no kernel virtual address of its own.  kmap() maps a
+   frame into a window of kernel virtual addresses, the last
+   4 MB of the address space, until kunmap() releases it.  */
+
+/* Base of the kmap window. */
+#define KMAP_BASE ((void *) 0xffc00000)
+
+void kmap_init (uint32_t *pd);
+void *kmap (uintptr_t frame);
+void kunmap (void *kpage);
+
+#endif /* threads/kmap.h */
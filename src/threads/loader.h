@@ -33,8 +33,14 @@
 #ifndef __ASSEMBLER__
 #include <stdint.h>
 
-/* Amount of physical memory, in 4 kB pages. */
+/* Amount of physical memory, in 4 kB pages, that is mapped
+   directly into the kernel's address space ("low memory"). */
 extern uint32_t init_ram_pages;
+
+/* Amount of physical memory, in 4 kB pages, above low memory
+   ("high memory").  It starts at physical address
+   init_ram_pages * PGSIZE. */
+extern uint32_t init_high_pages;
 #endif
 
 #endif /* threads/loader.h */
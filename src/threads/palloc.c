@@ -7,6 +7,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
+#include "threads/kmap.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -15,74 +17,138 @@
    page-multiple) chunks.  See malloc.h for an allocator that
    hands out smaller chunks.
 
-   System memory is divided into two "pools" called the kernel
-   and user pools.  The user pool is for user (virtual) memory
-   pages, the kernel pool for everything else.  The idea here is
-   that the kernel needs to have memory for its own operations
-   even if user processes are swapping like mad.
+   All free memory forms a single pool that is shared by two
+   classes of pages: user pages, for user (virtual) memory, and
+   kernel pages, for everything else.  Each class has a
+   reservation, a number of pages that only it may use, so that
+   the kernel has memory for its own operations even if user
+   processes are swapping like mad, and vice versa.  Pages
+   beyond the two reservations are lent to whichever class asks
+   for them first, so a file system heavy workload can grow its
+   kernel caches into memory that user processes leave idle, and
+   a memory heavy workload can do the opposite.  The user class
+   may also be capped by the -ul kernel command line option.
 
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   Each class also has a low watermark.  A class that has used
+   up its reservation may only borrow while the pool keeps, on
+   top of what is left of the other classes' reservations, their
+   low watermarks free as well.  This way, when one class is
+   under pressure, the other still has a little headroom past its
+   reservation while pages are reclaimed, rather than finding
+   every shared page lent out.
+
+   RAM above the 64 MB that the kernel maps directly forms a
+   second pool, high memory.  Its pages have no kernel virtual
+   address, so palloc_get_page() never returns them.  Instead,
+   palloc_get_frame() hands them out as physical frames, which
+   the kernel reaches through kmap() and which are meant for
+   user pages and caches.  High memory pages are charged to a
+   class's limit but not to the reservations, which only make
+   sense for memory the kernel can use directly. */
 
 /* A memory pool. */
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
-    uint8_t *base;                      /* Base of pool. */
+    struct bitmap *user_map;            /* Pages held by PALLOC_USER. */
+    uintptr_t base;                     /* Physical base of pool. */
+    size_t free_cnt;                    /* Number of free pages. */
+  };
+
+/* Page accounting for one class. */
+struct page_class
+  {
+    const char *name;                   /* Name, for statistics. */
+    size_t used;                        /* Low memory pages held. */
+    size_t peak;                        /* Largest value of USED. */
+    size_t high_used;                   /* High memory pages held. */
+    size_t reserved;                    /* Pages set aside for class. */
+    size_t low_wm;                      /* Pages kept free for class
+                                           while others borrow. */
+    size_t limit;                       /* Most pages class may hold. */
+    unsigned long long fail_cnt;        /* Failed allocations. */
   };
 
-/* Two pools: one for kernel data, one for user pages. */
-static struct pool kernel_pool, user_pool;
+/* Low memory, which all kernel pages come from, and high
+   memory, which may be empty. */
+static struct pool ram_pool, high_pool;
+
+/* Kernel and user page classes. */
+static struct page_class classes[PALLOC_CLASS_CNT] =
+  {
+    {"kernel", 0, 0, 0, 0, 0, SIZE_MAX, 0},
+    {"user", 0, 0, 0, 0, 0, SIZE_MAX, 0},
+  };
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
-static bool page_from_pool (const struct pool *, void *page);
+static size_t init_pool (struct pool *, uintptr_t base, size_t page_cnt,
+                         void *bm_base, const char *name);
+static size_t pool_get (struct pool *, enum palloc_class, size_t page_cnt);
+static void pool_free (struct pool *, size_t page_idx, size_t page_cnt);
+static bool frame_from_pool (const struct pool *, uintptr_t frame);
+static bool class_may_allocate (const struct pool *, enum palloc_class,
+                                size_t page_cnt);
+static size_t held_back (enum palloc_class, bool borrowing);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
-   pages are put into the user pool. */
+   pages may be given to user pages. */
 void
 palloc_init (size_t user_page_limit)
 {
   /* Free memory starts at 1 MB and runs to the end of RAM. */
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
-  size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
-
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
-}
-
-/* Obtains and returns a group of PAGE_CNT contiguous free pages.
-   If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+  size_t free_pages;
+  struct page_class *kernel = &classes[PALLOC_KERNEL];
+  struct page_class *user = &classes[PALLOC_USER];
+
+  /* High memory's bitmaps have to live in low memory. */
+  if (init_high_pages > 0)
+    {
+      size_t bm_pages = DIV_ROUND_UP (2 * bitmap_buf_size (init_high_pages),
+                                      PGSIZE);
+      init_pool (&high_pool, (uintptr_t) init_ram_pages * PGSIZE,
+                 init_high_pages, free_start, "high memory");
+      free_start += bm_pages * PGSIZE;
+    }
+
+  free_pages = (free_end - free_start) / PGSIZE;
+  free_pages = init_pool (&ram_pool, vtop (free_start), free_pages,
+                          free_start, "page pool");
+
+  /* Set aside a quarter of low memory for each class and share
+     the other half between them, keeping a thirty-second of it free
+     for each class while the other borrows. */
+  kernel->reserved = free_pages / 4;
+  user->reserved = free_pages / 4;
+  user->limit = user_page_limit;
+  if (user->reserved > user->limit)
+    user->reserved = user->limit;
+  kernel->low_wm = free_pages / 32;
+  user->low_wm = free_pages / 32;
+}
+
+/* Obtains and returns a group of PAGE_CNT contiguous free pages
+   from low memory.
+   If PAL_USER is set, the pages are charged to the user class,
+   otherwise to the kernel class.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   available to the class, returns a null pointer, unless
+   PAL_ASSERT is set in FLAGS, in which case the kernel
+   panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
-  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum palloc_class class = flags & PAL_USER ? PALLOC_USER : PALLOC_KERNEL;
   void *pages;
   size_t page_idx;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
+  page_idx = pool_get (&ram_pool, class, page_cnt);
   if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+    pages = ptov (ram_pool.base + PGSIZE * page_idx);
   else
     pages = NULL;
 
@@ -102,13 +168,13 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 
 /* Obtains a single free page and returns its kernel virtual
    address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
+   If PAL_USER is set, the page is charged to the user class,
+   otherwise to the kernel class.  If PAL_ZERO is set in FLAGS,
    then the page is filled with zeros.  If no pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
    FLAGS, in which case the kernel panics. */
 void *
-palloc_get_page (enum palloc_flags flags) 
+palloc_get_page (enum palloc_flags flags)
 {
   return palloc_get_multiple (flags, 1);
 }
@@ -117,66 +183,282 @@ palloc_get_page (enum palloc_flags flags)
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
-  struct pool *pool;
-  size_t page_idx;
-
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
 
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
+  if (!frame_from_pool (&ram_pool, vtop (pages)))
     NOT_REACHED ();
 
-  page_idx = pg_no (pages) - pg_no (pool->base);
-
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  pool_free (&ram_pool, (vtop (pages) - ram_pool.base) / PGSIZE, page_cnt);
 }
 
 /* Frees the page at PAGE. */
 void
-palloc_free_page (void *page) 
+palloc_free_page (void *page)
 {
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Obtains a single free page and returns its physical address,
+   or 0 if none is available.  The page comes from high memory
+   if possible, otherwise from low memory, so the kernel must
+   use kmap() to access it.  FLAGS are interpreted as for
+   palloc_get_page(). */
+uintptr_t
+palloc_get_frame (enum palloc_flags flags) 
+{
+  enum palloc_class class = flags & PAL_USER ? PALLOC_USER : PALLOC_KERNEL;
+  size_t page_idx = BITMAP_ERROR;
+  uintptr_t frame;
+
+  if (high_pool.used_map != NULL)
+    page_idx = pool_get (&high_pool, class, 1);
+  if (page_idx == BITMAP_ERROR)
+    {
+      void *page = palloc_get_page (flags);
+      return page != NULL ? vtop (page) : 0;
+    }
+
+  frame = high_pool.base + PGSIZE * page_idx;
+  if (flags & PAL_ZERO) 
+    {
+      void *kpage = kmap (frame);
+      memset (kpage, 0, PGSIZE);
+      kunmap (kpage);
+    }
+  return frame;
+}
+
+/* Frees the page at physical address FRAME, which must have been
+   obtained from palloc_get_frame(). */
+void
+palloc_free_frame (uintptr_t frame) 
+{
+  if (frame_from_pool (&high_pool, frame))
+    pool_free (&high_pool, (frame - high_pool.base) / PGSIZE, 1);
+  else
+    palloc_free_page (ptov (frame));
+}
+
+/* Returns the number of free pages in the pool. */
+size_t
+palloc_free_cnt (void)
+{
+  return ram_pool.free_cnt;
+}
+
+/* Returns the number of frames that palloc_get_frame() could
+   still hand out for user pages, in low and high memory, without
+   breaking into the kernel's reservation or low watermark or the
+   user class's limit.  Reads the counters without locking, so
+   the answer may be slightly out of date. */
+size_t
+palloc_user_free_cnt (void)
+{
+  const struct page_class *user = &classes[PALLOC_USER];
+  size_t held = user->used + user->high_used;
+  size_t kept = held_back (PALLOC_USER, false);
+  size_t wm = held_back (PALLOC_USER, true) - kept;
+  size_t unborrowed, room, avail;
+
+  room = user->limit > held ? user->limit - held : 0;
+
+  /* Pages up to the user reservation only have to leave the
+     other classes' unused reservations.  Borrowed ones also have
+     to leave their watermarks. */
+  avail = ram_pool.free_cnt > kept ? ram_pool.free_cnt - kept : 0;
+  unborrowed = user->reserved > user->used ? user->reserved - user->used : 0;
+  if (avail > unborrowed)
+    avail = unborrowed + (avail - unborrowed > wm
+                          ? avail - unborrowed - wm : 0);
+
+  if (high_pool.used_map != NULL)
+    avail += high_pool.free_cnt;
+  return avail < room ? avail : room;
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  int i;
+
+  printf ("Page allocator: %zu of %zu pages free\n",
+          ram_pool.free_cnt, bitmap_size (ram_pool.used_map));
+  if (high_pool.used_map != NULL)
+    printf ("  high memory: %zu of %zu pages free\n",
+            high_pool.free_cnt, bitmap_size (high_pool.used_map));
+  for (i = 0; i < PALLOC_CLASS_CNT; i++)
+    {
+      const struct page_class *c = &classes[i];
+      size_t lent = c->used > c->reserved ? c->used - c->reserved : 0;
+
+      printf ("  %s: %zu pages used (peak %zu), %zu in high memory, "
+              "%zu reserved, watermark %zu, %zu borrowed, "
+              "%llu failed allocations\n",
+              c->name, c->used, c->peak, c->high_used, c->reserved,
+              c->low_wm, lent, c->fail_cnt);
+    }
+}
+
+/* Takes PAGE_CNT contiguous pages from POOL on behalf of CLASS
+   and returns the index of the first, or BITMAP_ERROR if the
+   pool or the class cannot spare them. */
+static size_t
+pool_get (struct pool *pool, enum palloc_class class, size_t page_cnt) 
+{
+  struct page_class *c = &classes[class];
+  size_t page_idx;
+  enum intr_level old_level;
+
+  lock_acquire (&pool->lock);
+  if (class_may_allocate (pool, class, page_cnt))
+    page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+  else
+    page_idx = BITMAP_ERROR;
+
+  /* Pages are freed without the lock held, so update the
+     counters with interrupts off instead. */
+  old_level = intr_disable ();
+  if (page_idx != BITMAP_ERROR)
+    {
+      bitmap_set_multiple (pool->user_map, page_idx, page_cnt,
+                           class == PALLOC_USER);
+      pool->free_cnt -= page_cnt;
+      if (pool == &high_pool)
+        c->high_used += page_cnt;
+      else
+        {
+          c->used += page_cnt;
+          if (c->used > c->peak)
+            c->peak = c->used;
+        }
+    }
+  else if (pool == &ram_pool)
+    c->fail_cnt++;
+  intr_set_level (old_level);
+  lock_release (&pool->lock);
+
+  return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at index PAGE_IDX to
+   POOL.  Doesn't take the pool's lock, so that the scheduler can
+   free pages. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+pool_free (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  enum palloc_class class;
+  enum intr_level old_level;
+
+  class = (bitmap_test (pool->user_map, page_idx)
+           ? PALLOC_USER : PALLOC_KERNEL);
+  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+
+  old_level = intr_disable ();
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  pool->free_cnt += page_cnt;
+  if (pool == &high_pool)
+    classes[class].high_used -= page_cnt;
+  else
+    classes[class].used -= page_cnt;
+  intr_set_level (old_level);
+}
+
+/* Returns true if CLASS may take PAGE_CNT more pages from POOL:
+   it must stay within its limit and, in low memory, leave enough
+   free pages for the other classes, as held_back() says.  The
+   pool's lock must be held. */
+static bool
+class_may_allocate (const struct pool *pool, enum palloc_class class,
+                    size_t page_cnt) 
+{
+  const struct page_class *c = &classes[class];
+  size_t kept = 0;
+
+  ASSERT (lock_held_by_current_thread (&pool->lock));
+
+  if (c->used + c->high_used + page_cnt > c->limit)
+    return false;
+  if (pool == &ram_pool)
+    kept = held_back (class, c->used + page_cnt > c->reserved);
+  return pool->free_cnt >= kept + page_cnt;
+}
+
+/* Returns the number of free low memory pages that CLASS must
+   leave for the other classes: whatever part of their
+   reservations they have not used yet and, if BORROWING, that
+   is, if CLASS would go past its own reservation, their low
+   watermarks too. */
+static size_t
+held_back (enum palloc_class class, bool borrowing) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t kept = 0;
+  int i;
+
+  for (i = 0; i < PALLOC_CLASS_CNT; i++)
+    if (i != (int) class)
+      {
+        const struct page_class *c = &classes[i];
+
+        if (c->used < c->reserved)
+          kept += c->reserved - c->used;
+        if (borrowing)
+          kept += c->low_wm;
+      }
+  return kept;
+}
+
+/* Initializes pool P as starting at physical address BASE and
+   running for PAGE_CNT pages, naming it NAME for debugging
+   purposes.  The pool's bitmaps are put at kernel virtual
+   address BM_BASE.  If that lies within the pool, the bitmaps'
+   pages are subtracted from it.  Returns the number of pages
+   available for allocation. */
+static size_t
+init_pool (struct pool *p, uintptr_t base, size_t page_cnt, void *bm_base,
+           const char *name) 
+{
+  /* Calculate the space needed for the used_map and user_map
+     bitmaps. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (2 * bm_size, PGSIZE);
+  if (vtop (bm_base) == base) 
+    {
+      if (bm_pages > page_cnt)
+        PANIC ("Not enough memory in %s for bitmap.", name);
+      page_cnt -= bm_pages;
+      base += bm_pages * PGSIZE;
+    }
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf (page_cnt, bm_base, bm_size);
+  p->user_map = bitmap_create_in_buf (page_cnt, (uint8_t *) bm_base + bm_size,
+                                      bm_size);
+  p->base = base;
+  p->free_cnt = page_cnt;
+  return page_cnt;
 }
 
-/* Returns true if PAGE was allocated from POOL,
+/* Returns true if physical FRAME was allocated from POOL,
    false otherwise. */
 static bool
-page_from_pool (const struct pool *pool, void *page) 
+frame_from_pool (const struct pool *pool, uintptr_t frame) 
 {
-  size_t page_no = pg_no (page);
-  size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t page_no = frame / PGSIZE;
+  size_t start_page = pool->base / PGSIZE;
+  size_t end_page;
 
+  if (pool->used_map == NULL)
+    return false;
+  end_page = start_page + bitmap_size (pool->used_map);
   return page_no >= start_page && page_no < end_page;
 }
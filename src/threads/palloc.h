@@ -1,7 +1,9 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 /* How to allocate pages. */
 enum palloc_flags
@@ -11,10 +13,23 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Classes that pages are charged to. */
+enum palloc_class
+  {
+    PALLOC_KERNEL,              /* Kernel data. */
+    PALLOC_USER,                /* User (virtual) memory. */
+    PALLOC_CLASS_CNT            /* Number of classes. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+uintptr_t palloc_get_frame (enum palloc_flags);
+void palloc_free_frame (uintptr_t frame);
+size_t palloc_free_cnt (void);
+size_t palloc_user_free_cnt (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
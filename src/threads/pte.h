@@ -66,6 +66,8 @@ static inline uintptr_t pd_no (const void *va) {
 #define PTE_U 0x4               /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20              /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40              /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80             /* 1=4 MB page, 0=page table (PDEs only). */
+#define PTE_G 0x100             /* 1=global, kept in TLB across CR3 loads. */
 
 /* Returns a PDE that points to page table PT. */
 static inline uint32_t pde_create (uint32_t *pt) {
@@ -73,10 +75,23 @@ static inline uint32_t pde_create (uint32_t *pt) {
   return vtop (pt) | PTE_U | PTE_P | PTE_W;
 }
 
+/* Returns a PDE that maps the 4 MB region starting at kernel
+   virtual address PAGE with a single large page, without a page
+   table.  The mapping is global, so reloading CR3 on a process
+   switch does not flush it from the TLB.  Requires CR4.PSE and
+   CR4.PGE, which start.S turns on.
+   If WRITABLE is true then the region will be writable as well.
+   The region will be usable only by ring 0 code (the kernel). */
+static inline uint32_t pde_create_kernel_large (void *page, bool writable) {
+  ASSERT ((vtop (page) & (PTSPAN - 1)) == 0);
+  return vtop (page) | PTE_PS | PTE_G | PTE_P | (writable ? PTE_W : 0);
+}
+
 /* Returns a pointer to the page table that page directory entry
    PDE, which must "present", points to. */
 static inline uint32_t *pde_get_pt (uint32_t pde) {
   ASSERT (pde & PTE_P);
+  ASSERT (!(pde & PTE_PS));
   return ptov (pde & PTE_ADDR);
 }
 
@@ -97,11 +112,27 @@ static inline uint32_t pte_create_user (void *page, bool writable) {
   return pte_create_kernel (page, writable) | PTE_U;
 }
 
+/* Returns a PTE that points to physical page FRAME, which may
+   lie in high memory, for use by both user and kernel code.
+   The PTE's page is readable.
+   If WRITABLE is true then it will be writable as well. */
+static inline uint32_t pte_create_user_frame (uintptr_t frame,
+                                              bool writable) {
+  ASSERT ((frame & PGMASK) == 0);
+  return frame | PTE_P | PTE_U | (writable ? PTE_W : 0);
+}
+
 /* Returns a pointer to the page that page table entry PTE points
-   to. */
+   to.  The page must be in low memory. */
 static inline void *pte_get_page (uint32_t pte) {
   return ptov (pte & PTE_ADDR);
 }
 
+/* Returns the physical address of the page that page table entry
+   PTE points to. */
+static inline uintptr_t pte_get_frame (uint32_t pte) {
+  return pte & PTE_ADDR;
+}
+
 #endif /* threads/pte.h */
 
@@ -600,8 +600,16 @@ init_thread (struct thread *t, const char *name, int priority)
   lock_init(&t->childLock);
   cond_init(&t->childChange);
   list_init(&t->lockList); // MUST initialize the thread and put it into lockList
-  list_init(&t->openFiles);
+  t->fdTable = NULL;
+  t->fdTableSize = 0;
+  t->ring = NULL;
   list_init(&t->children);
+#ifdef USERPROG
+  list_init(&t->aio_requests);
+#endif
+#ifdef VM
+  list_init(&t->mappings);
+#endif
 }
 
 /* Allocates a SIZE-byte frame at the top of thread T's stack and
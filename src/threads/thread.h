@@ -2,6 +2,8 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <fault-stats.h>
+#include <hash.h>
 #include <list.h>
 #include <stdint.h>
 #include <threads/synch.h>
@@ -117,11 +119,33 @@ struct thread
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
     struct child_process * wait;
-    struct list openFiles;
+    struct file **fdTable;              /* Open files, indexed by fd. */
+    int fdTableSize;                    /* Slots in fdTable. */
+    uint8_t *ring;                      /* System call ring, or null. */
+    uint8_t *ring_upage;                /* User address of ring. */
+    bool sc_trace;                      /* Trace system calls? */
+
+    /* Owned by userprog/aio.c. */
+    struct list aio_requests;           /* Outstanding async I/O. */
+    int next_aio_id;                    /* Next async I/O identifier. */
     struct file * execFile;
     enum process_status pro_status;
     struct file * execute;
 #endif
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct hash pages;                  /* Supplemental page table. */
+    void *user_esp;                     /* User esp at last kernel entry. */
+    uint8_t *around_base;               /* First page of last fault-around. */
+    size_t around_cnt;                  /* Pages mapped by last fault-around. */
+    size_t around_max;                  /* Fault-around window, in pages. */
+    struct fault_stats faults;          /* Page fault statistics. */
+    int64_t ws_sampled;                 /* Ticks at last working set sample. */
+
+    /* Owned by userprog/syscall.c. */
+    struct list mappings;               /* Memory-mapped files. */
+    int next_mapid;                     /* Next mapping identifier. */
+#endif
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -0,0 +1,264 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdio.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+
+/* Asynchronous file I/O.
+
+   aio_submit() queues a read or write and returns at once with
+   an identifier for it.  One of a pool of kernel worker threads
+   picks the request up and carries it out, so the process can
+   keep running, and can keep more requests in flight, while the
+   worker waits for the disk.  With several workers, requests
+   for different disks proceed in parallel.
+
+   A worker does not run in the requesting process, so it cannot
+   touch the process's memory.  Instead each request has a
+   kernel buffer: aio_submit() copies a write's data into it, and
+   aio_wait(), which runs in the process, copies a read's data
+   out of it.  Each request also has its own handle on the file,
+   so that it can outlive the descriptor it was made through. */
+
+/* Number of worker threads. */
+#define AIO_WORKERS 4
+
+/* An asynchronous read or write. */
+struct aio_request
+  {
+    struct list_elem queue_elem;        /* Element in aio_queue. */
+    struct list_elem proc_elem;         /* Element in owner's list. */
+    int id;                             /* Identifier. */
+    bool write;                         /* Write, or read? */
+    struct file *file;                  /* Own handle on the file. */
+    off_t ofs;                          /* File offset. */
+    off_t size;                         /* Bytes to transfer. */
+    void *ubuf;                         /* User buffer. */
+    uint8_t *kbuf;                      /* Kernel buffer. */
+    size_t page_cnt;                    /* Pages in KBUF. */
+
+    /* Set by the worker. */
+    bool done;                          /* Carried out? */
+    off_t result;                       /* Bytes transferred. */
+    struct semaphore done_sema;         /* Upped when DONE is set. */
+  };
+
+/* Requests waiting for a worker. */
+static struct list aio_queue;
+static struct lock aio_lock;
+static struct condition aio_cond;       /* Signaled on new request. */
+
+/* Statistics. */
+static unsigned long long aio_requests;   /* Requests submitted. */
+static unsigned long long aio_bytes;      /* Bytes transferred. */
+static int aio_in_flight;                 /* Requests being carried out. */
+static int aio_peak;                      /* Largest AIO_IN_FLIGHT. */
+
+static thread_func aio_worker NO_RETURN;
+static struct aio_request *find_request (int id);
+static void free_request (struct aio_request *);
+
+/* Initializes asynchronous I/O and starts the workers. */
+void
+aio_init (void) 
+{
+  int i;
+
+  list_init (&aio_queue);
+  lock_init (&aio_lock);
+  cond_init (&aio_cond);
+  for (i = 0; i < AIO_WORKERS; i++)
+    if (thread_create ("aio", PRI_DEFAULT, aio_worker, NULL) == TID_ERROR)
+      PANIC ("aio_init: cannot start worker");
+}
+
+/* Queues a transfer of SIZE bytes between user buffer UBUF and
+   FILE, starting at offset OFS in FILE and leaving FILE's
+   position alone.  Reads from FILE into UBUF, or writes from
+   UBUF to FILE if WRITE is true.  Returns the new request's
+   identifier, or -1 if SIZE or OFS is out of range, the running
+   process has too many requests outstanding, or memory runs
+   out.  Terminates the process if WRITE is true and UBUF is not
+   valid. */
+int
+aio_submit (struct file *file, void *ubuf, off_t size, off_t ofs,
+            bool write) 
+{
+  struct thread *t = thread_current ();
+  struct aio_request *r;
+
+  if (size < 0 || size > AIO_MAX_SIZE || ofs < 0
+      || list_size (&t->aio_requests) >= AIO_MAX_REQUESTS)
+    return -1;
+
+  r = malloc (sizeof *r);
+  if (r == NULL)
+    return -1;
+  r->page_cnt = DIV_ROUND_UP (size, PGSIZE);
+  r->kbuf = NULL;
+  if (r->page_cnt > 0)
+    {
+      r->kbuf = palloc_get_multiple (0, r->page_cnt);
+      if (r->kbuf == NULL)
+        {
+          free (r);
+          return -1;
+        }
+    }
+  r->file = file_reopen (file);
+  if (r->file == NULL)
+    {
+      palloc_free_multiple (r->kbuf, r->page_cnt);
+      free (r);
+      return -1;
+    }
+  if (write && !copy_from_user (r->kbuf, ubuf, size))
+    {
+      free_request (r);
+      sys_exit (-1);
+    }
+  r->id = t->next_aio_id++;
+  r->write = write;
+  r->ofs = ofs;
+  r->size = size;
+  r->ubuf = ubuf;
+  r->done = false;
+  r->result = 0;
+  sema_init (&r->done_sema, 0);
+  list_push_back (&t->aio_requests, &r->proc_elem);
+
+  lock_acquire (&aio_lock);
+  list_push_back (&aio_queue, &r->queue_elem);
+  aio_requests++;
+  cond_signal (&aio_cond, &aio_lock);
+  lock_release (&aio_lock);
+  return r->id;
+}
+
+/* Returns 1 if the running process's request ID is done, 0 if it
+   is not done yet, or -1 if there is no such request.  Does not
+   wait, and does not finish the request; call aio_wait() for
+   that. */
+int
+aio_poll (int id) 
+{
+  struct aio_request *r = find_request (id);
+
+  if (r == NULL)
+    return -1;
+  return r->done ? 1 : 0;
+}
+
+/* Waits for the running process's request ID to be done and
+   finishes it: copies a read's data into the user buffer and
+   forgets the request.  Returns the number of bytes transferred,
+   or -1 if there is no such request.  Terminates the process if
+   the request was a read and its user buffer is not valid. */
+int
+aio_wait (int id) 
+{
+  struct aio_request *r = find_request (id);
+  off_t result;
+
+  if (r == NULL)
+    return -1;
+  sema_down (&r->done_sema);
+  result = r->result;
+  if (!r->write && !copy_to_user (r->ubuf, r->kbuf, result))
+    sys_exit (-1);
+  list_remove (&r->proc_elem);
+  free_request (r);
+  return result;
+}
+
+/* Waits for all of T's requests to be done and frees them,
+   discarding their results.  T must be the running thread. */
+void
+aio_exit (struct thread *t) 
+{
+  ASSERT (t == thread_current ());
+
+  while (!list_empty (&t->aio_requests))
+    {
+      struct list_elem *e = list_pop_front (&t->aio_requests);
+      struct aio_request *r = list_entry (e, struct aio_request, proc_elem);
+      sema_down (&r->done_sema);
+      free_request (r);
+    }
+}
+
+/* Prints statistics on asynchronous I/O. */
+void
+aio_print_stats (void) 
+{
+  printf ("AIO: %llu requests, %llu bytes, at most %d in flight\n",
+          aio_requests, aio_bytes, aio_peak);
+}
+
+/* Returns the running process's request ID, or a null pointer
+   if it has none by that identifier. */
+static struct aio_request *
+find_request (int id) 
+{
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&t->aio_requests); e != list_end (&t->aio_requests);
+       e = list_next (e))
+    {
+      struct aio_request *r = list_entry (e, struct aio_request, proc_elem);
+      if (r->id == id)
+        return r;
+    }
+  return NULL;
+}
+
+/* Frees request R, which must be done or never queued. */
+static void
+free_request (struct aio_request *r) 
+{
+  file_close (r->file);
+  palloc_free_multiple (r->kbuf, r->page_cnt);
+  free (r);
+}
+
+/* A worker thread.  Carries out queued requests, one at a
+   time. */
+static void
+aio_worker (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      struct aio_request *r;
+
+      lock_acquire (&aio_lock);
+      while (list_empty (&aio_queue))
+        cond_wait (&aio_cond, &aio_lock);
+      r = list_entry (list_pop_front (&aio_queue),
+                      struct aio_request, queue_elem);
+      if (++aio_in_flight > aio_peak)
+        aio_peak = aio_in_flight;
+      lock_release (&aio_lock);
+
+      if (r->write)
+        r->result = file_write_at (r->file, r->kbuf, r->size, r->ofs);
+      else
+        r->result = file_read_at (r->file, r->kbuf, r->size, r->ofs);
+
+      lock_acquire (&aio_lock);
+      aio_in_flight--;
+      aio_bytes += r->result;
+      lock_release (&aio_lock);
+
+      r->done = true;
+      sema_up (&r->done_sema);
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <stdbool.h>
+#include "filesys/off_t.h"
+
+struct file;
+struct thread;
+
+/* Largest request aio_submit() accepts, in bytes. */
+#define AIO_MAX_SIZE (64 * 1024)
+
+/* Most requests a process may have outstanding at once. */
+#define AIO_MAX_REQUESTS 16
+
+void aio_init (void);
+int aio_submit (struct file *, void *ubuf, off_t size, off_t ofs,
+                bool write);
+int aio_poll (int id);
+int aio_wait (int id);
+void aio_exit (struct thread *);
+void aio_print_stats (void);
+
+#endif /* userprog/aio.h */
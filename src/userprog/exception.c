@@ -2,14 +2,22 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -44,7 +52,6 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -59,6 +66,11 @@ exception_init (void)
      We need to disable interrupts for page faults because the
      fault address is stored in CR2 and needs to be preserved. */
   intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
+
+  /* Debug exceptions, too, because one can arrive in
+     sysenter_entry before it has switched to the thread's kernel
+     stack. */
+  intr_register_int (1, 0, INTR_OFF, debug, "#DB Debug Exception");
 }
 
 /* Prints exception statistics. */
@@ -109,6 +121,28 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Debug exception handler.  SYSENTER doesn't clear the trap
+   flag, so a process that sets it and then makes a system call
+   single-steps into sysenter_entry in ring 0.  Clears the flag
+   and lets the stub carry on.  Any other debug exception kills
+   the process, as before.  See userprog/sysenter.S. */
+static void
+debug (struct intr_frame *f) 
+{
+  uintptr_t eip = (uintptr_t) f->eip;
+
+  if (f->cs == SEL_KCSEG && (f->eflags & FLAG_TF) != 0
+      && eip >= (uintptr_t) sysenter_entry
+      && eip < (uintptr_t) sysenter_end)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+
+  intr_enable ();
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -149,11 +183,48 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in the page if it belongs to the process or extends
+     its stack, or give the process its own copy of a page it
+     shares copy-on-write.  This also covers the kernel touching
+     a user buffer during a system call, which is judged against
+     the stack pointer saved when the call began. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+  if ((not_present || write) && is_user_vaddr (fault_addr))
+    {
+      struct fault_stats *stats = &thread_current ()->faults;
+      uint64_t start = rdtsc ();
+      bool success = page_in (fault_addr, write);
+
+      if (not_present)
+        stats->not_present++;
+      else
+        stats->protection++;
+      stats->cycles += rdtsc () - start;
+      if (success)
+        return;
+    }
+#endif
+
   if(user)
   {
 	f->eip = f->eax;
 	sys_exit(-1);
   }
+
+  /* A kernel access to user memory that cannot be satisfied
+     resumes at the fixup for the faulting instruction; see
+     userprog/uaccess.c. */
+  if (is_user_vaddr (fault_addr))
+    {
+      uintptr_t resume = uaccess_fixup ((uintptr_t) f->eip);
+      if (resume != 0)
+        {
+          f->eip = (void (*) (void)) resume;
+          return;
+        }
+    }
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
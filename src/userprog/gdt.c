@@ -1,6 +1,9 @@
 #include "userprog/gdt.h"
+#include <cpuid.h>
 #include <debug.h>
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "threads/cpu.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
@@ -51,6 +54,21 @@ gdt_init (void)
   gdtr_operand = make_gdtr_operand (sizeof gdt - 1, gdt);
   asm volatile ("lgdt %0" : : "m" (gdtr_operand));
   asm volatile ("ltr %w0" : : "q" (SEL_TSS));
+
+  /* Set up SYSENTER, if the CPU has it, as a faster way into
+     the kernel for system calls than int $0x30.  SYSENTER and
+     SYSEXIT derive all the other selectors from SEL_KCSEG, which
+     is why the segments must be in the order above.  SYSENTER
+     also loads the stack pointer from an MSR, which would have to
+     be rewritten on every thread switch, so instead we point it
+     at a copy of the TSS's esp0 and sysenter_entry loads the real
+     stack pointer from there.  See userprog/sysenter.S. */
+  if (cpu_has_sysenter ())
+    {
+      wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+      wrmsr (MSR_SYSENTER_ESP, (uintptr_t) tss_get_sysenter_esp ());
+      wrmsr (MSR_SYSENTER_EIP, (uintptr_t) sysenter_entry);
+    }
 }
 
 /* System segment or code/data segment? */
@@ -4,12 +4,16 @@
 #include "threads/loader.h"
 
 /* Segment selectors.
-   More selectors are defined by the loader in loader.h. */
+   More selectors are defined by the loader in loader.h.
+   SYSEXIT requires SEL_UCSEG == SEL_KCSEG + 16 + 3 and SEL_UDSEG
+   == SEL_KCSEG + 24 + 3. */
 #define SEL_UCSEG       0x1B    /* User code selector. */
 #define SEL_UDSEG       0x23    /* User data selector. */
 #define SEL_TSS         0x28    /* Task-state segment. */
 #define SEL_CNT         6       /* Number of segments. */
 
+#ifndef __ASSEMBLER__
 void gdt_init (void);
+#endif
 
 #endif /* userprog/gdt.h */
@@ -2,23 +2,46 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 
+/* The accessed bit has two readers: eviction, through
+   pagedir_is_accessed() and pagedir_set_accessed(), and
+   working-set sampling, through pagedir_sample_accessed().  Each
+   clears PTE_A when it has seen it, so that it can tell whether
+   the page is accessed again, and first copies it into the
+   other's software bit, so that the other still sees the
+   access. */
+#define PTE_A_EVICT 0x200       /* Accessed, not yet seen by eviction. */
+#define PTE_A_SAMPLE 0x400      /* Accessed, not yet sampled. */
+
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static void invalidate_page (uint32_t *, const void *);
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
    Returns the new page directory, or a null pointer if memory
-   allocation fails. */
+   allocation fails.
+
+   The kernel half shares init_page_dir's entries, which point to
+   the same large pages and page tables, so no kernel page table
+   is copied.  Kernel page tables must therefore all exist before
+   the first call, which paging_init() guarantees. */
 uint32_t *
 pagedir_create (void) 
 {
   uint32_t *pd = palloc_get_page (0);
   if (pd != NULL)
-    memcpy (pd, init_page_dir, PGSIZE);
+    {
+      size_t kernel_pde = pd_no (PHYS_BASE);
+      memset (pd, 0, kernel_pde * sizeof *pd);
+      memcpy (pd + kernel_pde, init_page_dir + kernel_pde,
+              PGSIZE - kernel_pde * sizeof *pd);
+    }
   return pd;
 }
 
@@ -41,7 +64,7 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            palloc_free_frame (pte_get_frame (*pte));
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
@@ -97,13 +120,25 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
    failed. */
 bool
 pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
+{
+  ASSERT (pg_ofs (kpage) == 0);
+  ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
+
+  return pagedir_set_frame (pd, upage, vtop (kpage), writable);
+}
+
+/* Adds a mapping in page directory PD from user virtual page
+   UPAGE to physical page FRAME, which may be in high memory.
+   FRAME should probably be a page obtained with
+   palloc_get_frame().  Otherwise like pagedir_set_page(). */
+bool
+pagedir_set_frame (uint32_t *pd, void *upage, uintptr_t frame,
+                   bool writable)
 {
   uint32_t *pte;
 
   ASSERT (pg_ofs (upage) == 0);
-  ASSERT (pg_ofs (kpage) == 0);
   ASSERT (is_user_vaddr (upage));
-  ASSERT (vtop (kpage) >> PTSHIFT < init_ram_pages);
   ASSERT (pd != init_page_dir);
 
   pte = lookup_page (pd, upage, true);
@@ -111,7 +146,7 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
   if (pte != NULL) 
     {
       ASSERT ((*pte & PTE_P) == 0);
-      *pte = pte_create_user (kpage, writable);
+      *pte = pte_create_user_frame (frame, writable);
       return true;
     }
   else
@@ -121,7 +156,8 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
-   UADDR is unmapped. */
+   UADDR is unmapped.  The page must not be in high memory; use
+   pagedir_get_frame() if it might be. */
 void *
 pagedir_get_page (uint32_t *pd, const void *uaddr) 
 {
@@ -131,11 +167,31 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
   
   pte = lookup_page (pd, uaddr, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
-    return pte_get_page (*pte) + pg_ofs (uaddr);
+    {
+      ASSERT (pte_get_frame (*pte) >> PTSHIFT < init_ram_pages);
+      return pte_get_page (*pte) + pg_ofs (uaddr);
+    }
   else
     return NULL;
 }
 
+/* Looks up the physical address that corresponds to user virtual
+   address UADDR in PD and returns the address of its page, or 0
+   if UADDR is unmapped. */
+uintptr_t
+pagedir_get_frame (uint32_t *pd, const void *uaddr) 
+{
+  uint32_t *pte;
+
+  ASSERT (is_user_vaddr (uaddr));
+  
+  pte = lookup_page (pd, uaddr, false);
+  if (pte != NULL && (*pte & PTE_P) != 0)
+    return pte_get_frame (*pte);
+  else
+    return 0;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
@@ -152,7 +208,7 @@ pagedir_clear_page (uint32_t *pd, void *upage)
   if (pte != NULL && (*pte & PTE_P) != 0)
     {
       *pte &= ~PTE_P;
-      invalidate_pagedir (pd);
+      invalidate_page (pd, upage);
     }
 }
 
@@ -180,11 +236,38 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
       else 
         {
           *pte &= ~(uint32_t) PTE_D;
-          invalidate_pagedir (pd);
+          invalidate_page (pd, vpage);
         }
     }
 }
 
+/* Returns true if the PTE for virtual page VPAGE in PD is
+   present and writable.  Returns false if PD contains no such
+   PTE. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD.  The other bits, including the accessed and dirty
+   bits, are preserved. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL && ((*pte & PTE_W) != 0) != writable) 
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_page (pd, vpage);
+    }
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
    installed and the last time it was cleared.  Returns false if
@@ -193,7 +276,7 @@ bool
 pagedir_is_accessed (uint32_t *pd, const void *vpage) 
 {
   uint32_t *pte = lookup_page (pd, vpage, false);
-  return pte != NULL && (*pte & PTE_A) != 0;
+  return pte != NULL && (*pte & (PTE_A | PTE_A_EVICT)) != 0;
 }
 
 /* Sets the accessed bit to ACCESSED in the PTE for virtual page
@@ -208,14 +291,134 @@ pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed)
         *pte |= PTE_A;
       else 
         {
-          *pte &= ~(uint32_t) PTE_A; 
-          invalidate_pagedir (pd);
+          enum intr_level old_level = intr_disable ();
+          if (*pte & PTE_A)
+            *pte |= PTE_A_SAMPLE;
+          *pte &= ~(uint32_t) (PTE_A | PTE_A_EVICT);
+          intr_set_level (old_level);
+          invalidate_page (pd, vpage);
+        }
+    }
+}
+
+/* Returns true if the PTE for virtual page VPAGE in PD has been
+   accessed since the last call for the same page, and starts
+   over.  Unlike clearing the accessed bit with
+   pagedir_set_accessed(), does not hide the access from
+   pagedir_is_accessed().  Returns false if PD contains no PTE
+   for VPAGE. */
+bool
+pagedir_sample_accessed (uint32_t *pd, const void *vpage) 
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  enum intr_level old_level;
+  bool accessed, was_set;
+
+  if (pte == NULL)
+    return false;
+
+  old_level = intr_disable ();
+  was_set = (*pte & PTE_A) != 0;
+  accessed = was_set || (*pte & PTE_A_SAMPLE) != 0;
+  if (was_set)
+    *pte = (*pte & ~(uint32_t) PTE_A) | PTE_A_EVICT;
+  *pte &= ~(uint32_t) PTE_A_SAMPLE;
+  intr_set_level (old_level);
+  if (was_set)
+    invalidate_page (pd, vpage);
+  return accessed;
+}
+
+/* Starts an empty batch of TLB invalidations for PD.
+   Changes made through the batch take effect in the TLB only
+   when pagedir_batch_finish() is called, so the caller must not
+   depend on them, e.g. by freeing an unmapped page, before
+   then. */
+void
+pagedir_batch_init (struct pagedir_batch *b, uint32_t *pd) 
+{
+  b->pd = pd;
+  b->page_cnt = 0;
+}
+
+/* Records that the TLB entry for UPAGE in B's page directory
+   must be invalidated.  Once more than PAGEDIR_BATCH_MAX pages
+   are recorded, the batch gives up on single pages and
+   flushes everything instead. */
+static void
+batch_add (struct pagedir_batch *b, const void *upage) 
+{
+  if (b->page_cnt == SIZE_MAX)
+    return;
+  if (b->page_cnt < PAGEDIR_BATCH_MAX)
+    b->pages[b->page_cnt++] = upage;
+  else
+    b->page_cnt = SIZE_MAX;
+}
+
+/* Like pagedir_clear_page(), but defers the TLB invalidation to
+   pagedir_batch_finish(). */
+void
+pagedir_batch_clear_page (struct pagedir_batch *b, void *upage) 
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  pte = lookup_page (b->pd, upage, false);
+  if (pte != NULL && (*pte & PTE_P) != 0)
+    {
+      *pte &= ~PTE_P;
+      batch_add (b, upage);
+    }
+}
+
+/* Like pagedir_set_accessed(), but defers the TLB invalidation
+   to pagedir_batch_finish().  Eviction scans that clear many
+   accessed bits use this. */
+void
+pagedir_batch_set_accessed (struct pagedir_batch *b, const void *upage,
+                            bool accessed) 
+{
+  uint32_t *pte = lookup_page (b->pd, upage, false);
+  if (pte != NULL) 
+    {
+      if (accessed)
+        *pte |= PTE_A;
+      else if ((*pte & (PTE_A | PTE_A_EVICT)) != 0)
+        {
+          enum intr_level old_level = intr_disable ();
+          if (*pte & PTE_A)
+            *pte |= PTE_A_SAMPLE;
+          *pte &= ~(uint32_t) (PTE_A | PTE_A_EVICT);
+          intr_set_level (old_level);
+          batch_add (b, upage);
         }
     }
 }
 
+/* Carries out the invalidations collected in B, either page by
+   page or, past the threshold, with a single flush, and leaves B
+   empty. */
+void
+pagedir_batch_finish (struct pagedir_batch *b) 
+{
+  if (b->page_cnt == SIZE_MAX)
+    invalidate_pagedir (b->pd);
+  else if (active_pd () == b->pd)
+    {
+      size_t i;
+
+      for (i = 0; i < b->page_cnt; i++)
+        invlpg (b->pages[i]);
+    }
+  b->page_cnt = 0;
+}
+
 /* Loads page directory PD into the CPU's page directory base
-   register. */
+   register.  Kernel mappings are global, so only the user part
+   of the TLB is flushed. */
 void
 pagedir_activate (uint32_t *pd) 
 {
@@ -261,3 +464,12 @@ invalidate_pagedir (uint32_t *pd)
       pagedir_activate (pd);
     } 
 }
+
+/* Invalidates the TLB entry for VADDR if PD is the active page
+   directory, leaving the rest of the TLB intact. */
+static void
+invalidate_page (uint32_t *pd, const void *vaddr) 
+{
+  if (active_pd () == pd)
+    invlpg (vaddr);
+}
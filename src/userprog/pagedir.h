@@ -2,17 +2,43 @@
 #define USERPROG_PAGEDIR_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Largest number of single-page invalidations a batch collects.
+   Past this, flushing the whole TLB once is cheaper. */
+#define PAGEDIR_BATCH_MAX 32
+
+/* TLB invalidations collected for one page directory, to be
+   carried out together by pagedir_batch_finish(). */
+struct pagedir_batch
+  {
+    uint32_t *pd;                       /* Page directory. */
+    size_t page_cnt;                    /* Pages in PAGES, or
+                                           SIZE_MAX for a full flush. */
+    const void *pages[PAGEDIR_BATCH_MAX]; /* Pages to invalidate. */
+  };
+
 uint32_t *pagedir_create (void);
 void pagedir_destroy (uint32_t *pd);
 bool pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool rw);
+bool pagedir_set_frame (uint32_t *pd, void *upage, uintptr_t frame, bool rw);
 void *pagedir_get_page (uint32_t *pd, const void *upage);
+uintptr_t pagedir_get_frame (uint32_t *pd, const void *upage);
 void pagedir_clear_page (uint32_t *pd, void *upage);
 bool pagedir_is_dirty (uint32_t *pd, const void *upage);
 void pagedir_set_dirty (uint32_t *pd, const void *upage, bool dirty);
+bool pagedir_is_writable (uint32_t *pd, const void *upage);
+void pagedir_set_writable (uint32_t *pd, const void *upage, bool writable);
 bool pagedir_is_accessed (uint32_t *pd, const void *upage);
 void pagedir_set_accessed (uint32_t *pd, const void *upage, bool accessed);
+bool pagedir_sample_accessed (uint32_t *pd, const void *upage);
 void pagedir_activate (uint32_t *pd);
 
+void pagedir_batch_init (struct pagedir_batch *, uint32_t *pd);
+void pagedir_batch_clear_page (struct pagedir_batch *, void *upage);
+void pagedir_batch_set_accessed (struct pagedir_batch *, const void *upage,
+                                 bool accessed);
+void pagedir_batch_finish (struct pagedir_batch *);
+
 #endif /* userprog/pagedir.h */
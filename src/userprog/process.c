@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "userprog/aio.h"
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
@@ -15,12 +16,21 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/kmap.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
+#ifdef VM
+static thread_func fork_process NO_RETURN;
+#endif
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 static struct lock process_lock;
 
@@ -128,6 +138,97 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+struct fork_helper
+{
+	struct thread *parent; // Process being forked, blocked until the child is set up
+	const struct intr_frame *if_; // Parent's user registers at the fork() call
+	struct semaphore done;
+	bool success;
+	struct child_process * child;
+};
+
+/* Starts a new process that is a copy of the running one, which
+   called fork() with user registers IF_.  The child's memory is
+   shared copy-on-write with the parent rather than copied, and
+   it gets its own handles on the parent's open files.  Returns
+   the child's thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (const struct intr_frame *if_)
+{
+	struct fork_helper fork;
+	tid_t tid;
+
+	fork.parent = thread_current();
+	fork.if_ = if_;
+	sema_init(&fork.done, 0);
+
+	tid = thread_create (thread_current()->name, PRI_DEFAULT, fork_process, &fork);
+	if (tid != TID_ERROR)
+	{
+		sema_down(&fork.done);
+		if (fork.success)
+		{
+			list_push_back(&thread_current()->children, &fork.child->elem);
+		}
+		else
+		{
+			tid = TID_ERROR;
+		}
+	}
+	return tid;
+}
+
+/* A thread function that copies the forking process and returns
+   to user mode where it left off, with 0 as fork()'s result. */
+static void
+fork_process (void *fork_)
+{
+  struct fork_helper *fork = fork_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = *fork->if_;
+  bool success = false;
+
+  cur->pagedir = pagedir_create ();
+  if (cur->pagedir != NULL)
+  {
+	page_table_init ();
+	process_activate ();
+	cur->execFile = file_reopen (fork->parent->execFile);
+	if (cur->execFile != NULL)
+	{
+		file_deny_write (cur->execFile);
+		success = page_table_fork (fork->parent, cur->execFile)
+			&& copy_open_files (fork->parent);
+	}
+  }
+
+  if(success)
+  {
+	cur->wait = malloc(sizeof *fork->child);
+	fork->child = cur->wait;
+	success = (fork->child != NULL);
+  }
+  if(success)
+  {
+	lock_init(&fork->child->wait_lock);
+	fork->child->pid = cur->tid;
+	fork->child->status = -1;
+  	sema_init(&fork->child->sema, 0);
+  }
+  fork->success = success;
+  sema_up(&fork->done);
+  if (!success)
+  {
+    	thread_exit ();
+  }
+
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+#endif
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -179,9 +280,20 @@ process_exit (void)
     struct list_elem *f;
     struct child_process *curProcess;
 
+#ifdef VM
+    /* Write mapped files back before the parent can see us exit. */
+    free_mappings(cur);
+#endif
+
     if(cur->wait != NULL)
     {
 	curProcess = cur->wait;
+#ifdef VM
+	if(page_report_faults)
+	{
+		page_print_faults();
+	}
+#endif
 	printf("%s: exit(%d)\n", cur->name, curProcess->status);
 	sema_up(&curProcess->sema);
     }
@@ -193,6 +305,8 @@ process_exit (void)
     }
 
     free_open_files(thread_current());
+    free_ring(cur);
+    aio_exit(cur);
     file_close(cur->execFile);
 
     pd = cur->pagedir;
@@ -205,6 +319,9 @@ process_exit (void)
          directory before destroying the process's page
          directory, or our active page directory will be one
          that's been freed (and cleared). */
+#ifdef VM
+      page_table_destroy ();
+#endif
       cur->pagedir = NULL;
       pagedir_activate (NULL);
       pagedir_destroy (pd);
@@ -316,6 +433,9 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
+#ifdef VM
+  page_table_init ();
+#endif
   process_activate();
 
 	//if( (strcspn(cmd_line, " ")- 1) <= (NAME_MAX + 2) ) 
@@ -424,7 +544,9 @@ load (const char *cmd_line, void (**eip) (void), void **esp)
 
 /* load() helpers. */
 
-static bool install_page (void *upage, void *kpage, bool writable);
+#ifndef VM
+static bool install_page (void *upage, uintptr_t frame, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -483,6 +605,10 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With virtual memory, the pages are only recorded in the
+   supplemental page table here, and page_in() reads each of them
+   the first time the process touches it.
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -502,25 +628,39 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+#ifdef VM
+      struct page *p;
+
+      if (page_read_bytes > 0)
+        p = page_add_file (upage, file, ofs, page_read_bytes, writable);
+      else
+        p = page_add_zero (upage, writable);
+      if (p == NULL)
+        return false;
+      ofs += page_read_bytes;
+#else
+      uint8_t *kpage;
+      bool ok;
+
       /* Get a page of memory. */
-      uint8_t *kpage = palloc_get_page (PAL_USER);
-      if (kpage == NULL)
+      uintptr_t frame = palloc_get_frame (PAL_USER);
+      if (frame == 0)
         return false;
 
       /* Load this page. */
-      if (file_read (file, kpage, page_read_bytes) != (int) page_read_bytes)
-        {
-          palloc_free_page (kpage);
-          return false; 
-        }
-      memset (kpage + page_read_bytes, 0, page_zero_bytes);
+      kpage = kmap (frame);
+      ok = file_read (file, kpage, page_read_bytes) == (int) page_read_bytes;
+      if (ok)
+        memset (kpage + page_read_bytes, 0, page_zero_bytes);
+      kunmap (kpage);
 
       /* Add the page to the process's address space. */
-      if (!install_page (upage, kpage, writable)) 
+      if (!ok || !install_page (upage, frame, writable)) 
         {
-          palloc_free_page (kpage);
+          palloc_free_frame (frame);
           return false; 
         }
+#endif
 
       /* Advance. */
       read_bytes -= page_read_bytes;
@@ -639,40 +779,55 @@ setup_stack_helper (const char * cmd_line, uint8_t * kpage, uint8_t * upage, voi
 static bool
 setup_stack (void **esp, char *cmdline) 
 {
-  uint8_t *kpage;
+  uint8_t *upage = ( (uint8_t *) PHYS_BASE) - PGSIZE;
+  uintptr_t frame;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-  if (kpage != NULL) 
+#ifdef VM
+  /* Keep the page pinned while the arguments go onto it. */
+  frame = 0;
+  if (page_add_zero (upage, true) != NULL && page_lock (upage, true))
+    frame = page_lookup (upage)->frame->paddr;
+  success = frame != 0;
+#else
+  frame = palloc_get_frame (PAL_USER | PAL_ZERO);
+  if (frame != 0) 
     {
-      uint8_t *upage = ( (uint8_t *) PHYS_BASE) - PGSIZE;
-      success = install_page (upage, kpage, true);
-      if (success){
-        *esp = PHYS_BASE - 12;
-        success = setup_stack_helper(cmdline, kpage, upage, esp);
-      }
-      else
-        palloc_free_page (kpage);
+      success = install_page (upage, frame, true);
+      if (!success)
+        palloc_free_frame (frame);
     }
+#endif
+  if (success){
+    uint8_t *kpage = kmap (frame);
+    *esp = PHYS_BASE - 12;
+    success = setup_stack_helper(cmdline, kpage, upage, esp);
+    kunmap (kpage);
+#ifdef VM
+    page_unlock (upage);
+#endif
+  }
   return success;
 }
 
-/* Adds a mapping from user virtual address UPAGE to kernel
-   virtual address KPAGE to the page table.
+#ifndef VM
+/* Adds a mapping from user virtual address UPAGE to physical
+   page FRAME to the page table.
    If WRITABLE is true, the user process may modify the page;
    otherwise, it is read-only.
    UPAGE must not already be mapped.
-   KPAGE should probably be a page obtained from the user pool
-   with palloc_get_page().
+   FRAME should probably be a page obtained from the user class
+   with palloc_get_frame().
    Returns true on success, false if UPAGE is already mapped or
    if memory allocation fails. */
 static bool
-install_page (void *upage, void *kpage, bool writable)
+install_page (void *upage, uintptr_t frame, bool writable)
 {
   struct thread *t = thread_current ();
 
   /* Verify that there's not already a page at that virtual
      address, then map our page there. */
-  return (pagedir_get_page (t->pagedir, upage) == NULL
-          && pagedir_set_page (t->pagedir, upage, kpage, writable));
+  return (pagedir_get_frame (t->pagedir, upage) == 0
+          && pagedir_set_frame (t->pagedir, upage, frame, writable));
 }
+#endif
@@ -1,20 +1,39 @@
-#include "lib/kernel/hash.h"
+#include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/off_t.h"
 #include "userprog/syscall.h"
+#include <iovec.h>
+#include <ring.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
+#include "threads/kmap.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "userprog/aio.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
-static struct hash fd_hash;
-static struct lock filesys_lock;
+static void syscall_dispatch (struct intr_frame *, unsigned callNum, int *args);
+static void profile_call (struct intr_frame *, unsigned callNum, int *args);
 static struct lock process_lock;
-static inline bool get_user (uint8_t *dst, const uint8_t *usrc);
+
+/* Statistics on file reads and writes. */
+static unsigned long long io_calls;     /* Calls that reached a file. */
+static unsigned long long io_bytes;     /* Bytes they moved. */
+
+/* Statistics on system call rings. */
+static unsigned long long ring_enters;  /* ring_enter() calls. */
+static unsigned long long ring_ops;     /* Requests they carried out. */
 static uint8_t syscall_arg[] = 
 {
 	0, /*Halt*/
@@ -30,95 +49,217 @@ static uint8_t syscall_arg[] =
 	2, /*Seek*/
 	1, /*Tell*/
 	1, /*Close*/
+	2, /*Mmap*/
+	1, /*Munmap*/
+	1, /*Chdir*/
+	1, /*Mkdir*/
+	2, /*Readdir*/
+	1, /*Isdir*/
+	1, /*Inumber*/
+	0, /*Fork*/
+	1, /*Fault stats*/
+	4, /*Pread*/
+	4, /*Pwrite*/
+	3, /*Readv*/
+	3, /*Writev*/
+	1, /*Ring setup*/
+	0, /*Ring enter*/
+	3, /*Copy file range*/
+	4, /*Aio read*/
+	4, /*Aio write*/
+	1, /*Aio poll*/
+	1, /*Aio wait*/
+	1, /*Trace*/
 };
 
-struct open_file
+/* Number of system calls. */
+#define SYSCALL_CNT (sizeof syscall_arg / sizeof *syscall_arg)
+
+/* System call names, for profiles and traces. */
+static const char *syscall_names[] = 
 {
-	struct hash_elem h_elem;
-	struct list_elem l_elem;
-	int fd;
-	int pid;
-	struct file * file;
+	"halt", "exit", "exec", "wait", "create", "remove", "open",
+	"filesize", "read", "write", "seek", "tell", "close", "mmap",
+	"munmap", "chdir", "mkdir", "readdir", "isdir", "inumber", "fork",
+	"get_fault_stats", "pread", "pwrite", "readv", "writev",
+	"ring_setup", "ring_enter", "copy_file_range", "aio_read",
+	"aio_write", "aio_poll", "aio_wait", "trace",
 };
 
-static bool verify(const char *buffer)
+/* Profile system calls?  Set by kernel command-line options
+ * "-scstat" and "-sctrace", or by the first trace() call.  Until
+ * then the handler tests only this. */
+bool syscall_profile;
+
+/* Trace every process's system calls?  Set by "-sctrace". */
+bool syscall_trace_all;
+
+/* Latencies are counted in buckets by their base-2 logarithm, in
+ * CPU cycles. */
+#define SC_HIST_BUCKETS 32
+
+/* Profile of one system call. */
+struct sc_profile
 {
-	struct thread *t = thread_current();
-	return is_user_vaddr(buffer) && pagedir_get_page(t->pagedir, buffer) != NULL;
-}
+	unsigned long long calls;       /* Times called. */
+	unsigned long long returns;     /* Times returned. */
+	unsigned long long cycles;      /* Cycles spent in returned calls. */
+	uint64_t max;                   /* Longest call, in cycles. */
+	unsigned hist[SC_HIST_BUCKETS]; /* Latency histogram. */
+};
+static struct sc_profile sc_profiles[SYSCALL_CNT];
+
+/* Number of calls the trace buffer holds.  Older ones are
+ * overwritten. */
+#define SC_TRACE_ENTRIES 256
 
-static int allocate_fd(void)
+/* One traced system call. */
+struct sc_trace
 {
-	static int fd_curr = 2;
-	return fd_curr++;
-}
+	unsigned seq;                   /* Sequence number, 0 if unused. */
+	tid_t tid;                      /* Calling process. */
+	char name[16];                  /* Its name. */
+	unsigned num;                   /* System call number. */
+	int args[4];                    /* Arguments. */
+	int ret;                        /* Return value, if DONE. */
+	uint64_t cycles;                /* Duration, if DONE. */
+	bool done;                      /* Returned? */
+};
+static struct sc_trace sc_traces[SC_TRACE_ENTRIES];
+static unsigned sc_trace_seq;       /* Sequence number of last call. */
 
-static unsigned filesys_fdhash_func (const struct hash_elem *e, void *aux)
+static bool verify(const char *buffer)
 {
-	struct open_file *ret = hash_entry(e, struct open_file, h_elem);
-	return (unsigned)ret->fd;
+	struct thread *t = thread_current();
+	if(!is_user_vaddr(buffer))
+	{
+		return false;
+	}
+#ifdef VM
+	/* Pages that haven't been touched yet are valid too, as are
+	 * stack pages not yet grown; the kernel's own access will
+	 * fault them in. */
+	if(page_lookup(buffer) != NULL || page_is_stack(buffer))
+	{
+		return true;
+	}
+#endif
+	return pagedir_get_frame(t->pagedir, buffer) != 0;
 }
 
-static bool filesys_fdhash_less(const struct hash_elem *a, const struct hash_elem *b, void * aux)
+/* Smallest size of a process's descriptor table. */
+#define FD_TABLE_MIN 16
+
+/* Grows T's descriptor table to hold at least SIZE descriptors,
+ * leaving the new slots empty.  Returns false if memory runs
+ * out. */
+static bool grow_fd_table(struct thread *t, int size)
 {
-	struct open_file *a_file = hash_entry(a, struct open_file, h_elem);
-	struct open_file *b_file = hash_entry(b, struct open_file, h_elem);
-	
-	return (a_file->fd < b_file->fd);
+	int new_size = t->fdTableSize > 0 ? t->fdTableSize : FD_TABLE_MIN;
+	struct file **table;
+	int fd;
+	while(new_size < size)
+	{
+		new_size *= 2;
+	}
+	if(new_size <= t->fdTableSize)
+	{
+		return true;
+	}
+	table = realloc(t->fdTable, new_size * sizeof *table);
+	if(table == NULL)
+	{
+		return false;
+	}
+	for(fd = t->fdTableSize; fd < new_size; fd++)
+	{
+		table[fd] = NULL;
+	}
+	t->fdTable = table;
+	t->fdTableSize = new_size;
+	return true;
 }
 
-
-static struct open_file * fd_to_open_file(int fd)
+/* Gives FILE the lowest free descriptor in the running process's
+ * table and returns it, or -1 if memory runs out.  Descriptors 0
+ * and 1 are the console. */
+static int allocate_fd(struct file *file)
 {
-	struct open_file s;
-	s.fd = fd;
 	struct thread *t = thread_current();
-	struct hash_elem *f = hash_find (&fd_hash, &s.h_elem);
-	if(f == NULL)
+	int fd;
+	for(fd = 2; fd < t->fdTableSize && t->fdTable[fd] != NULL; fd++)
 	{
-		return NULL;
+		continue;
 	}
-	struct open_file * ret = hash_entry(f, struct open_file, h_elem);
-	if(t->tid != ret->pid)
+	if(fd >= t->fdTableSize && !grow_fd_table(t, fd + 1))
 	{
-		return NULL;
+		return -1;
 	}
-	return ret;
+	t->fdTable[fd] = file;
+	return fd;
 }
 
-
-static void filesys_free_open_file(struct open_file * opened_file)
+/* Returns the file open as FD in the running process, or a null
+ * pointer if there is none.  Only the process itself touches its
+ * descriptor table, so this needs no lock. */
+static struct file * fd_to_file(int fd)
 {
-	file_close(opened_file->file);
-	lock_acquire(&filesys_lock);
-	hash_delete(&fd_hash, &opened_file->h_elem);
-	lock_release(&filesys_lock);
-	list_remove(&opened_file->l_elem);
-	free(opened_file);
+	struct thread *t = thread_current();
+	if(fd < 2 || fd >= t->fdTableSize)
+	{
+		return NULL;
+	}
+	return t->fdTable[fd];
 }
 
+/* Closes every file T has open and frees its descriptor table. */
 void free_open_files(struct thread * t)
 {
-	struct list_elem * e;
-	for(e = list_begin(&t->openFiles); e != list_end(&t->openFiles);)
+	int fd;
+	for(fd = 2; fd < t->fdTableSize; fd++)
 	{
-		struct list_elem * nextElement = list_next(e);
-		struct open_file * file_being_freed = list_entry(e, struct open_file, l_elem);
-		filesys_free_open_file(file_being_freed);
-		e = nextElement;
+		if(t->fdTable[fd] != NULL)
+		{
+			file_close(t->fdTable[fd]);
+		}
 	}
+	free(t->fdTable);
+	t->fdTable = NULL;
+	t->fdTableSize = 0;
 }
-static struct file * fd_to_file(int fd)
+
+/* Gives the running thread its own handle on each file that
+ * PARENT has open, under the same descriptor and at the same
+ * position, for fork().  Returns false if memory runs out. */
+bool copy_open_files(struct thread * parent)
 {
-	lock_acquire(&filesys_lock);
-	struct open_file * f = fd_to_open_file(fd);
-	lock_release(&filesys_lock);
-	if(f == NULL)
+	struct thread *t = thread_current();
+	int fd;
+	if(parent->fdTableSize == 0)
 	{
-		return NULL;
+		return true;
+	}
+	if(!grow_fd_table(t, parent->fdTableSize))
+	{
+		return false;
 	}
-	return f->file;
+	for(fd = 2; fd < parent->fdTableSize; fd++)
+	{
+		struct file *file = parent->fdTable[fd];
+		if(file == NULL)
+		{
+			continue;
+		}
+		t->fdTable[fd] = file_reopen(file);
+		if(t->fdTable[fd] == NULL)
+		{
+			return false;
+		}
+		file_seek(t->fdTable[fd], file_tell(file));
+	}
+	return true;
 }
+
 static void sys_halt (void);
 void sys_exit (int status);
 static pid_t sys_exec (const char *cmd_line);
@@ -132,6 +273,21 @@ static int sys_write (int fd, void *buffer, unsigned size);
 static void sys_seek (int fd, unsigned position);
 static unsigned sys_tell (int fd);
 static void sys_close (int fd);
+static int sys_pread (int fd, void *buffer, unsigned size, off_t offset);
+static int sys_pwrite (int fd, void *buffer, unsigned size, off_t offset);
+static int sys_readv (int fd, const struct iovec *iov, int iovcnt);
+static int sys_writev (int fd, const struct iovec *iov, int iovcnt);
+static int sys_ring_setup (void *addr);
+static int sys_ring_enter (void);
+static int sys_copy_file_range (int fd_in, int fd_out, unsigned len);
+static int sys_aio (int fd, void *buffer, unsigned size, off_t offset, bool write);
+static unsigned sys_trace (bool on);
+#ifdef VM
+static int sys_mmap (int fd, void *addr);
+static void sys_munmap (int mapid);
+static pid_t sys_fork (struct intr_frame *f);
+static void sys_fault_stats (struct fault_stats *stats);
+#endif
 
 struct semaphore file_acc;
 
@@ -139,102 +295,116 @@ void
 syscall_init (void) 
 {
   	intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-	lock_init(&filesys_lock);
-	hash_init(&fd_hash, filesys_fdhash_func, filesys_fdhash_less, NULL);
 	lock_init(&process_lock);
+	ASSERT(sizeof(struct ring_sq) <= PGSIZE && sizeof(struct ring_cq) <= PGSIZE);
+	ASSERT(sizeof syscall_names / sizeof *syscall_names == SYSCALL_CNT);
 }
 
-/* Copies SIZE bytes from user address USRC to kernel address DST.
- * Call thread_exit() if any of the user accesses are invalid. */
-static void copy_in (void *dst_, const void *usrc_, size_t size)
+/* Returns true if UADDR is a valid, mapped user address, false otherwise. */
+static bool verify_user (const void *uaddr)
 {
-	uint8_t *dst = dst_;
-	const uint8_t *usrc = usrc_;
+	return uaddr < PHYS_BASE && verify (uaddr);
+}
 
-	for (; size > 0; size--, dst++, usrc++)
+/* Returns the bucket of the latency histogram for CYCLES. */
+static int sc_bucket(uint64_t cycles)
+{
+	int bucket = 0;
+	while(cycles > 1 && bucket < SC_HIST_BUCKETS - 1)
 	{
-		if(usrc >= (uint8_t *) PHYS_BASE || !get_user (dst, usrc))
-		{
-			thread_exit();
-		}
+		cycles >>= 1;
+		bucket++;
 	}
+	return bucket;
 }
 
-
-/* Creates a copy of user string US in kernel memory and returns it as
- * a page that must be freed with palloc_free_page(). Truncates the string at
- * PGSIZE bytes in size. Call thread_exit() if any of the user accesses are invalid. */
-static char * copy_in_string (const char *us)
+/* Carries out system call CALLNUM with arguments ARGS, like
+ * syscall_dispatch(), timing it for the profile and logging it
+ * in the trace buffer if the process is being traced. */
+static void profile_call(struct intr_frame *f, unsigned callNum, int *args)
 {
-	char *ks;
-	size_t length;
+	struct thread *t = thread_current();
+	struct sc_profile *p = &sc_profiles[callNum];
+	struct sc_trace *tr = NULL;
+	enum intr_level old_level;
+	unsigned seq = 0;
+	uint64_t start, cycles;
 
-	ks = palloc_get_page (0);
-	if(ks == NULL)
-	{
-		thread_exit();
-	}
-	for( length = 0; length < PGSIZE; length++)
+	/* Log the call before making it, since exit() and halt()
+	 * don't return. */
+	old_level = intr_disable();
+	p->calls++;
+	if(t->sc_trace || syscall_trace_all)
 	{
-		if(us >= (char *) PHYS_BASE || !get_user (ks + length, us++))
-		{
-			palloc_free_page (ks);
-			thread_exit();
-		}
-		if(ks[length] == '\0')
-		{
-			return ks;
-		}
+		seq = ++sc_trace_seq;
+		tr = &sc_traces[seq % SC_TRACE_ENTRIES];
+		tr->seq = seq;
+		tr->tid = t->tid;
+		strlcpy(tr->name, t->name, sizeof tr->name);
+		tr->num = callNum;
+		memcpy(tr->args, args, sizeof tr->args);
+		tr->done = false;
 	}
-	ks[PGSIZE-1] = '\0';
-	return ks;
-}
+	intr_set_level(old_level);
 
-/* Copies a byte from user address USRC to kernel address DST. USRC must be 
- * below PHYS_BASE. Returns true if successful, false if a segfault occured. */
-static inline bool get_user (uint8_t *dst, const uint8_t *usrc)
-{
-	int eax;
-	asm("movl $1f, %%eax; movb %2, %%al; movb %%al, %0; 1:"
-		: "=m" (*dst), "=&a" (eax) : "m" (*usrc));
-	return eax != 0;
-}
+	start = rdtsc();
+	syscall_dispatch(f, callNum, args);
+	cycles = rdtsc() - start;
 
-/* Returns true if UADDR is a valid, mapped user address, false otherwise. */
-static bool verify_user (const void *uaddr)
-{
-	struct thread *t = thread_current();
-	return (uaddr < PHYS_BASE && pagedir_get_page (t->pagedir, uaddr) != NULL);
+	old_level = intr_disable();
+	p->returns++;
+	p->cycles += cycles;
+	if(cycles > p->max)
+	{
+		p->max = cycles;
+	}
+	p->hist[sc_bucket(cycles)]++;
+	/* Unless the entry was reused meanwhile. */
+	if(tr != NULL && tr->seq == seq)
+	{
+		tr->ret = f->eax;
+		tr->cycles = cycles;
+		tr->done = true;
+	}
+	intr_set_level(old_level);
 }
 
 static void
 syscall_handler (struct intr_frame *f ) 
 {
   unsigned callNum;
-  int args[3];
+  int args[4];
   int numOfArgs;
-  int i;
+#ifdef VM
+  thread_current()->user_esp = f->esp;
+#endif
   //##Get syscall number
-  if(!verify_user(f->esp))
+  if(!copy_from_user(&callNum, f->esp, sizeof callNum)
+     || callNum >= sizeof syscall_arg / sizeof *syscall_arg)
   {
- 	sys_exit(-1);
+	sys_exit(-1);
   }
 
-  copy_in (&callNum, f->esp, sizeof callNum);
-
   //##Using the number find out which system call is being used
   numOfArgs = syscall_arg[callNum];
-
-  for(i = 1; i <= numOfArgs; i++)
+  if(!copy_from_user(args, (uint32_t *) f->esp + 1, sizeof *args * numOfArgs))
   {
-  	if(!verify_user(f->esp + i))
-  	{
- 		sys_exit(-1);
- 	}
+	sys_exit(-1);
   }
 
-  copy_in(args, (uint32_t *) f->esp + 1, sizeof *args * numOfArgs);
+  if(syscall_profile)
+  {
+	profile_call(f, callNum, args);
+	return;
+  }
+  syscall_dispatch(f, callNum, args);
+}
 
+/* Carries out system call CALLNUM with arguments ARGS, putting
+ * its return value in F. */
+static void
+syscall_dispatch (struct intr_frame *f, unsigned callNum, int *args)
+{
   //##Use switch statement or something and run this below for each
   //##Depending on the callNum...
   //f->eax = desired_syscall_fun (args[0],args[1], args[2]);
@@ -279,6 +449,56 @@ syscall_handler (struct intr_frame *f )
 		case 12 :
 			sys_close(args[0]);
 			break;
+		case 22 :
+			f->eax = sys_pread(args[0], (void *) args[1], args[2], args[3]);
+			break;
+		case 23 :
+			f->eax = sys_pwrite(args[0], (void *) args[1], args[2], args[3]);
+			break;
+		case 24 :
+			f->eax = sys_readv(args[0], (const struct iovec *) args[1], args[2]);
+			break;
+		case 25 :
+			f->eax = sys_writev(args[0], (const struct iovec *) args[1], args[2]);
+			break;
+		case 26 :
+			f->eax = sys_ring_setup((void *) args[0]);
+			break;
+		case 27 :
+			f->eax = sys_ring_enter();
+			break;
+		case 28 :
+			f->eax = sys_copy_file_range(args[0], args[1], args[2]);
+			break;
+		case 29 :
+			f->eax = sys_aio(args[0], (void *) args[1], args[2], args[3], false);
+			break;
+		case 30 :
+			f->eax = sys_aio(args[0], (void *) args[1], args[2], args[3], true);
+			break;
+		case 31 :
+			f->eax = aio_poll(args[0]);
+			break;
+		case 32 :
+			f->eax = aio_wait(args[0]);
+			break;
+		case 33 :
+			f->eax = sys_trace(args[0]);
+			break;
+#ifdef VM
+		case 13 :
+			f->eax = sys_mmap(args[0], (void *) args[1]);
+			break;
+		case 14 :
+			sys_munmap(args[0]);
+			break;
+		case 20 :
+			f->eax = sys_fork(f);
+			break;
+		case 21 :
+			sys_fault_stats((struct fault_stats *) args[0]);
+			break;
+#endif
 		default:
 			thread_exit();
 	
@@ -314,12 +534,23 @@ void sys_exit (int status)
 
 static pid_t sys_exec(const char * cmd_line)
 {
-	if(cmd_line == NULL || !verify(cmd_line))
+	char *command = palloc_get_page(0);
+	int length;
+	pid_t pid;
+	if(command == NULL)
 	{
+		return -1;
+	}
+	length = strncpy_from_user(command, cmd_line, PGSIZE);
+	if(length < 0)
+	{
+		palloc_free_page(command);
 		sys_exit(-1);
 	}
-	char * command = copy_in_string(cmd_line);
-	pid_t pid = process_execute(command);
+	/* Truncate command lines longer than a page. */
+	command[PGSIZE - 1] = '\0';
+	pid = process_execute(command);
+	palloc_free_page(command);
 	
 	return pid == TID_ERROR ? -1 : pid;
 }
@@ -358,37 +589,34 @@ static bool sys_remove(const char *path)
 int fd_open(const char * file)
 {
 	struct file *fileOpen = filesys_open(file);
-	struct thread *t = thread_current();
+	int new_fd;
 	if(fileOpen == NULL)
 	{
 		return -1;
 	}
-	struct open_file *hash = malloc(sizeof(struct open_file));
-	if(hash == NULL)
+	new_fd = allocate_fd(fileOpen);
+	if(new_fd == -1)
 	{
 		file_close(fileOpen);
-		return -1;
 	}
-	int new_fd = allocate_fd();
-	hash->fd = new_fd;
-	hash->file = fileOpen;	
-	hash->pid = t->tid;
-	
-	lock_acquire(&filesys_lock);
-	hash_insert(&fd_hash, &hash->h_elem);
-	lock_release(&filesys_lock);
-	list_push_back(&t->openFiles, &hash->l_elem);
 	return new_fd;
 }
 
 
 static int sys_open(const char *file)
 {
-	if(file == NULL || !verify(file)) 
+	char name[NAME_MAX + 2];
+	int length = strncpy_from_user(name, file, sizeof name);
+	if(length < 0)
 	{
 		sys_exit(-1);
 	}
-	return fd_open(file);
+	/* Too long to be the name of any file. */
+	if((size_t) length == sizeof name)
+	{
+		return -1;
+	}
+	return fd_open(name);
 }
 
 static int sys_filesize(int fd)
@@ -401,6 +629,117 @@ static int sys_filesize(int fd)
 	return file_length(fileOpen);
 }
 
+#ifdef VM
+/* Returns true if user page UPAGE is mapped in the running
+ * process's page directory but has no supplemental page table
+ * entry, as the system call ring's pages do.  Such pages stay in
+ * memory, so they need no pinning. */
+static bool is_fixed_page(const void *upage)
+{
+	return is_user_vaddr(upage) && page_lookup(upage) == NULL
+	       && pagedir_get_frame(thread_current()->pagedir, upage) != 0;
+}
+#endif
+
+/* Pins the user page that holds UADDR in memory and returns a
+ * kernel address for it, so that the file system can move data
+ * between the disk and the page without going through the user
+ * mapping or a bounce buffer.  WRITE is true if the kernel will
+ * write to the page.  Calls sys_exit(-1) if the page is invalid.
+ * Release the page with put_user_page(). */
+static uint8_t * get_user_page(const void *uaddr, bool write)
+{
+	struct thread *t = thread_current();
+	void *upage = pg_round_down(uaddr);
+	uintptr_t frame;
+#ifdef VM
+	if(is_fixed_page(upage))
+	{
+		if(write && !pagedir_is_writable(t->pagedir, upage))
+		{
+			sys_exit(-1);
+		}
+	}
+	else if(!page_lock(upage, write))
+	{
+		sys_exit(-1);
+	}
+#else
+	if(!is_user_vaddr(upage) || (write && !pagedir_is_writable(t->pagedir, upage)))
+	{
+		sys_exit(-1);
+	}
+#endif
+	frame = pagedir_get_frame(t->pagedir, upage);
+	if(frame == 0)
+	{
+		sys_exit(-1);
+	}
+	return kmap(frame);
+}
+
+/* Releases KPAGE, which get_user_page() returned for UADDR.
+ * WRITTEN is true if the kernel wrote to it.  The user mapping
+ * did not see the access, so its accessed and dirty bits are set
+ * here. */
+static void put_user_page(const void *uaddr, uint8_t *kpage, bool written)
+{
+	struct thread *t = thread_current();
+	void *upage = pg_round_down(uaddr);
+	kunmap(kpage);
+	pagedir_set_accessed(t->pagedir, upage, true);
+	if(written)
+	{
+		pagedir_set_dirty(t->pagedir, upage, true);
+	}
+#ifdef VM
+	if(!is_fixed_page(upage))
+	{
+		page_unlock(upage);
+	}
+#endif
+}
+
+/* Reads SIZE bytes from FILE into user BUFFER if TO_USER is
+ * true, otherwise writes them from BUFFER to FILE, a user page
+ * at a time.  Starts at byte POS of the file and leaves the
+ * file's position alone, or at the file's position and advances
+ * it if POS is negative.  Returns the number of bytes moved. */
+static int file_transfer(struct file *file, uint8_t *buffer, unsigned size, off_t pos, bool to_user)
+{
+	int total = 0;
+	io_calls++;
+	while(size > 0)
+	{
+		unsigned ofs = pg_ofs(buffer);
+		unsigned chunk = PGSIZE - ofs < size ? PGSIZE - ofs : size;
+		uint8_t *kpage = get_user_page(buffer, to_user);
+		int n;
+		if(pos < 0)
+		{
+			n = to_user ? file_read(file, kpage + ofs, chunk) : file_write(file, kpage + ofs, chunk);
+		}
+		else if(to_user)
+		{
+			n = file_read_at(file, kpage + ofs, chunk, pos + total);
+		}
+		else
+		{
+			n = file_write_at(file, kpage + ofs, chunk, pos + total);
+		}
+		put_user_page(buffer, kpage, to_user && n > 0);
+		total += n;
+		io_bytes += n;
+		if((unsigned) n != chunk)
+		{
+			break;
+		}
+		buffer += n;
+		size -= n;
+	}
+	return total;
+}
+
 int fd_read(int fd, void *buffer, unsigned size)
 {
 	struct file *fileOpen = fd_to_file(fd);
@@ -408,7 +747,7 @@ int fd_read(int fd, void *buffer, unsigned size)
 	{
 		return -1;
 	}
-	return file_read(fileOpen, buffer, size);
+	return file_transfer(fileOpen, buffer, size, -1, true);
 }
 
 static int conRead(char * buffer, unsigned size)
@@ -468,7 +807,7 @@ int fd_write(int fd, const void * buffer, unsigned size)
 	{
 		return -1;
 	}
-	return file_write(fileOpen, buffer, size);
+	return file_transfer(fileOpen, (uint8_t *) buffer, size, -1, false);
 }
 
 static int console_write(char * buffer, unsigned size) // chunks of 128 bytes each
@@ -546,13 +885,412 @@ static unsigned sys_tell (int fd)
 
 static void sys_close(int fd)
 {
-	struct open_file *f = fd_to_open_file(fd);
-	if(f != NULL)
+	struct file *file = fd_to_file(fd);
+	if(file != NULL)
 	{
-		filesys_free_open_file(f);
+		file_close(file);
+		thread_current()->fdTable[fd] = NULL;
 	}
 }
 
+/* Reads or writes SIZE bytes between user BUFFER and the file
+ * open as FD, starting at OFFSET, for pread() and pwrite().  The
+ * file's position does not move.  Returns the number of bytes
+ * moved, or -1 if FD is not an open file or OFFSET is negative. */
+static int positional_io(int fd, void *buffer, unsigned size, off_t offset, bool to_user)
+{
+	struct file *file = fd_to_file(fd);
+	if(file == NULL || offset < 0)
+	{
+		return -1;
+	}
+	if(size > 0 && (!verify_user(buffer) || !is_user_vaddr((uint8_t *) buffer + size - 1)))
+	{
+		sys_exit(-1);
+	}
+	return file_transfer(file, buffer, size, offset, to_user);
+}
+
+static int sys_pread(int fd, void *buffer, unsigned size, off_t offset)
+{
+	return positional_io(fd, buffer, size, offset, true);
+}
+
+static int sys_pwrite(int fd, void *buffer, unsigned size, off_t offset)
+{
+	return positional_io(fd, buffer, size, offset, false);
+}
+
+/* Number of iovecs copied in from the user at a time. */
+#define IOV_BATCH 16
+
+/* Reads into (if TO_USER) or writes from the IOVCNT buffers that
+ * user array IOV describes, in order, through sys_read() or
+ * sys_write() so that the console works too.  Stops at the first
+ * short transfer.  Returns the total number of bytes moved, or -1
+ * if IOVCNT is out of range or nothing could be moved at all. */
+static int vectored_io(int fd, const struct iovec *iov, int iovcnt, bool to_user)
+{
+	struct iovec batch[IOV_BATCH];
+	int total = 0;
+	int i;
+	if(iovcnt < 0 || iovcnt > IOV_MAX)
+	{
+		return -1;
+	}
+	for(i = 0; i < iovcnt; i++)
+	{
+		struct iovec *v = &batch[i % IOV_BATCH];
+		int n;
+		if(i % IOV_BATCH == 0)
+		{
+			int cnt = iovcnt - i < IOV_BATCH ? iovcnt - i : IOV_BATCH;
+			if(!copy_from_user(batch, iov + i, cnt * sizeof *batch))
+			{
+				sys_exit(-1);
+			}
+		}
+		if(v->iov_len == 0)
+		{
+			continue;
+		}
+		n = to_user ? sys_read(fd, v->iov_base, v->iov_len) : sys_write(fd, v->iov_base, v->iov_len);
+		if(n < 0)
+		{
+			return total > 0 ? total : -1;
+		}
+		total += n;
+		if((size_t) n != v->iov_len)
+		{
+			break;
+		}
+	}
+	return total;
+}
+
+static int sys_readv(int fd, const struct iovec *iov, int iovcnt)
+{
+	return vectored_io(fd, iov, iovcnt, true);
+}
+
+static int sys_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return vectored_io(fd, iov, iovcnt, false);
+}
+
+/* Copies up to LEN bytes from the file open as FD_IN to the file
+ * open as FD_OUT, starting at and advancing each file's position.
+ * The data goes from inode to inode inside the kernel and never
+ * through user memory.  Returns the number of bytes copied, or -1
+ * if either descriptor is not an open file or the two ranges
+ * overlap in the same file. */
+static int sys_copy_file_range(int fd_in, int fd_out, unsigned len)
+{
+	struct file *in = fd_to_file(fd_in);
+	struct file *out = fd_to_file(fd_out);
+	off_t in_pos, out_pos, size;
+	if(in == NULL || out == NULL)
+	{
+		return -1;
+	}
+	in_pos = file_tell(in);
+	out_pos = file_tell(out);
+	/* No more than is left to read, which also keeps the
+	 * positions below from overflowing. */
+	size = file_length(in) - in_pos;
+	if(size < 0)
+	{
+		size = 0;
+	}
+	if(len < (unsigned) size)
+	{
+		size = len;
+	}
+	if(file_get_inode(in) == file_get_inode(out)
+	   && in_pos < out_pos + size && out_pos < in_pos + size)
+	{
+		return -1;
+	}
+	return file_copy(out, in, size);
+}
+
+/* Starts reading SIZE bytes at OFFSET in the file open as FD into
+ * user BUFFER, or writing them from BUFFER if WRITE is true, and
+ * returns an identifier for aio_poll() and aio_wait(), or -1 on
+ * failure.  See userprog/aio.c. */
+static int sys_aio(int fd, void *buffer, unsigned size, off_t offset, bool write)
+{
+	struct file *file = fd_to_file(fd);
+	if(file == NULL || size > AIO_MAX_SIZE)
+	{
+		return -1;
+	}
+	return aio_submit(file, buffer, size, offset, write);
+}
+
+#ifdef VM
+/* Returns true if user page UPAGE is part of T's system call
+ * ring. */
+static bool in_ring(struct thread *t, const uint8_t *upage)
+{
+	return t->ring != NULL && upage >= t->ring_upage && upage < t->ring_upage + 2 * PGSIZE;
+}
+#endif
+
+/* Gives the running process a system call ring (see lib/ring.h)
+ * in the two pages at user address ADDR.  The pages stay in
+ * memory and are shared with the kernel until the process exits;
+ * fork() does not copy them.  Returns 0 if successful, -1 if the
+ * process already has a ring, ADDR is not page-aligned, or either
+ * page is already in use. */
+static int sys_ring_setup(void *addr)
+{
+	struct thread *t = thread_current();
+	uint8_t *upage = addr;
+	uint8_t *kpage;
+	int i;
+
+	if(t->ring != NULL || upage == NULL || pg_ofs(upage) != 0
+	   || upage >= (uint8_t *) PHYS_BASE - 2 * PGSIZE)
+	{
+		return -1;
+	}
+#ifdef VM
+	if(upage + 2 * PGSIZE > (uint8_t *) PHYS_BASE - page_stack_max)
+	{
+		return -1;
+	}
+#endif
+	for(i = 0; i < 2; i++)
+	{
+		if(pagedir_get_frame(t->pagedir, upage + i * PGSIZE) != 0)
+		{
+			return -1;
+		}
+#ifdef VM
+		if(page_lookup(upage + i * PGSIZE) != NULL)
+		{
+			return -1;
+		}
+#endif
+	}
+
+	kpage = palloc_get_multiple(PAL_USER | PAL_ZERO, 2);
+	if(kpage == NULL)
+	{
+		return -1;
+	}
+	if(!pagedir_set_page(t->pagedir, upage, kpage, true)
+	   || !pagedir_set_page(t->pagedir, upage + PGSIZE, kpage + PGSIZE, true))
+	{
+		pagedir_clear_page(t->pagedir, upage);
+		palloc_free_multiple(kpage, 2);
+		return -1;
+	}
+	t->ring = kpage;
+	t->ring_upage = upage;
+	return 0;
+}
+
+/* Unmaps and frees T's system call ring, if it has one. */
+void free_ring(struct thread *t)
+{
+	if(t->ring == NULL)
+	{
+		return;
+	}
+	pagedir_clear_page(t->pagedir, t->ring_upage);
+	pagedir_clear_page(t->pagedir, t->ring_upage + PGSIZE);
+	palloc_free_multiple(t->ring, 2);
+	t->ring = NULL;
+}
+
+/* Carries out ring request SQE and returns its result. */
+static int ring_do(const struct ring_sqe *sqe)
+{
+	switch(sqe->op)
+	{
+		case RING_READ :
+			return sys_read(sqe->fd, sqe->buf, sqe->len);
+		case RING_WRITE :
+			return sys_write(sqe->fd, sqe->buf, sqe->len);
+		case RING_OPEN :
+			return sys_open(sqe->buf);
+		case RING_CLOSE :
+			sys_close(sqe->fd);
+			return 0;
+		case RING_SEEK :
+			sys_seek(sqe->fd, sqe->len);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+/* Carries out the requests queued on the running process's
+ * system call ring, in order, posting a completion for each,
+ * until the submission queue is empty or the completion queue is
+ * full.  Returns the number of requests carried out, or -1 if the
+ * process has no ring or its submission queue is corrupt. */
+static int sys_ring_enter(void)
+{
+	struct thread *t = thread_current();
+	struct ring_sq *sq;
+	struct ring_cq *cq;
+	uint32_t head, tail;
+	int done = 0;
+
+	if(t->ring == NULL)
+	{
+		return -1;
+	}
+	sq = (struct ring_sq *) t->ring;
+	cq = (struct ring_cq *) (t->ring + PGSIZE);
+	/* The indexes live in user memory, so trust them no further
+	 * than the size of the queue. */
+	head = sq->head;
+	tail = sq->tail;
+	if(tail - head > RING_ENTRIES)
+	{
+		return -1;
+	}
+	while(head != tail && cq->tail - cq->head < RING_ENTRIES)
+	{
+		struct ring_sqe sqe = sq->entries[head % RING_ENTRIES];
+		struct ring_cqe *cqe = &cq->entries[cq->tail % RING_ENTRIES];
+		cqe->res = ring_do(&sqe);
+		cqe->user_data = sqe.user_data;
+		cq->tail++;
+		sq->head = ++head;
+		done++;
+	}
+	ring_enters++;
+	ring_ops += done;
+	return done;
+}
+
+#ifdef VM
+/* A memory-mapped file.  Holds its own reopened file, so that
+ * closing or removing the file the process opened doesn't break
+ * the mapping. */
+struct mapping
+{
+	struct list_elem elem;
+	int id;
+	struct file *file;
+	uint8_t *base;
+	size_t page_cnt;
+};
+
+/* Removes mapping M from the running process, writing its
+ * modified pages back to the file, and frees it. */
+static void unmap(struct mapping *m)
+{
+	page_remove_range(m->base, m->page_cnt);
+	file_close(m->file);
+	list_remove(&m->elem);
+	free(m);
+}
+
+/* Maps the file open as FD at user address ADDR.  Pages are read
+ * in only when first touched and written back only if modified.
+ * Returns the new mapping's identifier, or -1 if FD is not open,
+ * the file is empty, ADDR is not page-aligned, or the mapping
+ * would overlap existing pages or the area reserved for the
+ * stack. */
+static int sys_mmap(int fd, void *addr)
+{
+	struct thread *t = thread_current();
+	struct file *file = fd_to_file(fd);
+	struct mapping *m;
+	off_t length, ofs;
+
+	if(file == NULL || addr == NULL || pg_ofs(addr) != 0)
+	{
+		return -1;
+	}
+	length = file_length(file);
+	if(length == 0)
+	{
+		return -1;
+	}
+	m = malloc(sizeof *m);
+	if(m == NULL)
+	{
+		return -1;
+	}
+	m->file = file_reopen(file);
+	if(m->file == NULL)
+	{
+		free(m);
+		return -1;
+	}
+	m->id = t->next_mapid++;
+	m->base = addr;
+	m->page_cnt = 0;
+	list_push_back(&t->mappings, &m->elem);
+
+	for(ofs = 0; ofs < length; ofs += PGSIZE)
+	{
+		uint8_t *upage = m->base + ofs;
+		uint32_t read_bytes = length - ofs < PGSIZE ? length - ofs : PGSIZE;
+		if(upage >= (uint8_t *) PHYS_BASE - page_stack_max || in_ring(t, upage) || page_add_mmap(upage, m->file, ofs, read_bytes) == NULL)
+		{
+			unmap(m);
+			return -1;
+		}
+		m->page_cnt++;
+	}
+	return m->id;
+}
+
+/* Removes the running process's mapping MAPID, if it has one. */
+static void sys_munmap(int mapid)
+{
+	struct thread *t = thread_current();
+	struct list_elem *e;
+	for(e = list_begin(&t->mappings); e != list_end(&t->mappings); e = list_next(e))
+	{
+		struct mapping *m = list_entry(e, struct mapping, elem);
+		if(m->id == mapid)
+		{
+			unmap(m);
+			return;
+		}
+	}
+}
+
+/* Creates a copy of the running process that shares its memory
+ * copy-on-write.  Returns the child's pid to the parent and 0 to
+ * the child, or -1 if the child cannot be created. */
+static pid_t sys_fork(struct intr_frame *f)
+{
+	tid_t tid = process_fork(f);
+	return tid == TID_ERROR ? -1 : tid;
+}
+
+/* Copies the running process's page fault statistics to
+ * STATS. */
+static void sys_fault_stats(struct fault_stats *stats)
+{
+	if(!copy_to_user(stats, &thread_current()->faults, sizeof *stats))
+	{
+		sys_exit(-1);
+	}
+}
+
+/* Removes all of T's mappings, which must be the running
+ * thread's, writing their modified pages back. */
+void free_mappings(struct thread * t)
+{
+	ASSERT(t == thread_current());
+	while(!list_empty(&t->mappings))
+	{
+		unmap(list_entry(list_front(&t->mappings), struct mapping, elem));
+	}
+}
+#endif
+
 struct child_process * add_child_process ( int pid) 
 {
 	struct child_process *cp = malloc(sizeof( struct child_process) );
@@ -583,3 +1321,114 @@ void remove_child_process (struct child_process *cp)
 	list_remove(&cp->elem);
 	free(cp);
 }
+
+/* Turns tracing of the running process's system calls on or
+ * off and returns the number of calls traced so far, by any
+ * process.  See syscall_dump_trace(). */
+static unsigned sys_trace(bool on)
+{
+	thread_current()->sc_trace = on;
+	if(on)
+	{
+		syscall_profile = true;
+	}
+	return sc_trace_seq;
+}
+
+/* Prints system call argument ARG, in hex if it looks like an
+ * address. */
+static void print_arg(int arg)
+{
+	if(arg >= -4096 && arg < 65536)
+	{
+		printf("%d", arg);
+	}
+	else
+	{
+		printf("%#x", (unsigned) arg);
+	}
+}
+
+/* Prints the traced system calls still in the trace buffer,
+ * oldest first: the process, the call and its arguments, and the
+ * return value and duration in cycles, or "?" for a call that
+ * hasn't returned. */
+void syscall_dump_trace(void)
+{
+	unsigned first = sc_trace_seq >= SC_TRACE_ENTRIES ? sc_trace_seq - SC_TRACE_ENTRIES + 1 : 1;
+	unsigned seq;
+	printf("Syscall trace: %u calls, last %u shown\n", sc_trace_seq,
+	       sc_trace_seq - first + 1);
+	for(seq = first; seq != sc_trace_seq + 1; seq++)
+	{
+		struct sc_trace *tr = &sc_traces[seq % SC_TRACE_ENTRIES];
+		int i;
+		if(tr->seq != seq)
+		{
+			continue;
+		}
+		printf("%5u %s(%d): %s(", seq, tr->name, tr->tid, syscall_names[tr->num]);
+		for(i = 0; i < syscall_arg[tr->num]; i++)
+		{
+			if(i > 0)
+			{
+				printf(", ");
+			}
+			print_arg(tr->args[i]);
+		}
+		if(tr->done)
+		{
+			printf(") = %d, %llu cycles\n", tr->ret, tr->cycles);
+		}
+		else
+		{
+			printf(") = ?\n");
+		}
+	}
+}
+
+/* Prints the profile of each system call that has been made:
+ * calls, average and longest latency, and a histogram of
+ * latencies in powers of 2 of CPU cycles. */
+static void print_profiles(void)
+{
+	unsigned num;
+	printf("Syscall profile (cycles):\n");
+	for(num = 0; num < SYSCALL_CNT; num++)
+	{
+		struct sc_profile *p = &sc_profiles[num];
+		int b;
+		if(p->calls == 0)
+		{
+			continue;
+		}
+		printf("  %s: %llu calls, avg %llu, max %llu\n   ",
+		       syscall_names[num], p->calls,
+		       p->returns != 0 ? p->cycles / p->returns : 0, p->max);
+		for(b = 0; b < SC_HIST_BUCKETS; b++)
+		{
+			if(p->hist[b] != 0)
+			{
+				printf(" 2^%d:%u", b, p->hist[b]);
+			}
+		}
+		printf("\n");
+	}
+}
+
+/* Prints statistics on file reads and writes. */
+void syscall_print_stats(void)
+{
+	unsigned long long per_call = io_calls != 0 ? io_bytes / io_calls : 0;
+	printf("Syscall: %llu file reads and writes, %llu bytes, "
+	       "%llu bytes per call\n", io_calls, io_bytes, per_call);
+	if(ring_enters > 0)
+	{
+		printf("Syscall: %llu ring requests in %llu ring_enter calls\n",
+		       ring_ops, ring_enters);
+	}
+	if(syscall_profile)
+	{
+		print_profiles();
+	}
+}
@@ -6,6 +6,14 @@
 
 typedef int pid_t;
 
+/* Profile system calls?  Controlled by kernel command-line
+   options "-scstat" and "-sctrace". */
+extern bool syscall_profile;
+
+/* Trace all processes' system calls?  Controlled by kernel
+   command-line option "-sctrace". */
+extern bool syscall_trace_all;
+
 struct child_process
 {
 	int pid;
@@ -23,8 +31,17 @@ struct child_process * add_child_process (int pid);
 struct child_process * get_child_process (int pid);
 void remove_child_process (struct child_process *cp);
 void free_open_files(struct thread *);
+bool copy_open_files(struct thread *);
+void free_ring(struct thread *);
+#ifdef VM
+void free_mappings(struct thread *);
+#endif
 
 void syscall_init (void);
+void sysenter_entry (void);
+extern const char sysenter_end[];
+void syscall_print_stats (void);
+void syscall_dump_trace (void);
 int fd_open(const char *);
 int fd_read(int, void *, unsigned);
 int fd_write(int, const void *, unsigned);
@@ -75,6 +75,15 @@ struct tss
 /* Kernel TSS. */
 static struct tss *tss;
 
+/* The rest of the TSS's page serves as the stack that SYSENTER
+   switches to.  Its top word is kept equal to esp0, so that
+   sysenter_entry can switch to the running thread's kernel
+   stack in one instruction.  The room below it takes the
+   interrupt frame of a debug exception that arrives before
+   then, which happens if the process entered with the trap flag
+   set.  See userprog/sysenter.S. */
+static void **sysenter_esp;
+
 /* Initializes the kernel TSS. */
 void
 tss_init (void) 
@@ -83,6 +92,7 @@ tss_init (void)
      few fields of it are ever referenced, and those are the only
      ones we initialize. */
   tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  sysenter_esp = (void **) ((uint8_t *) tss + PGSIZE) - 1;
   tss->ss0 = SEL_KDSEG;
   tss->bitmap = 0xdfff;
   tss_update ();
@@ -96,11 +106,23 @@ tss_get (void)
   return tss;
 }
 
-/* Sets the ring 0 stack pointer in the TSS to point to the end
-   of the thread stack. */
+/* Returns the stack pointer for SYSENTER to load.  The word
+   there is a copy of the TSS's ring 0 stack pointer, which
+   tss_update() keeps pointing to the running thread's kernel
+   stack. */
+void **
+tss_get_sysenter_esp (void) 
+{
+  ASSERT (tss != NULL);
+  return sysenter_esp;
+}
+
+/* Sets the ring 0 stack pointer in the TSS, and its copy for
+   SYSENTER, to point to the end of the thread stack. */
 void
 tss_update (void) 
 {
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
+  *sysenter_esp = tss->esp0;
 }
@@ -0,0 +1,150 @@
+#include "userprog/uaccess.h"
+#include <debug.h>
+#include <string.h>
+#include "threads/vaddr.h"
+
+/* Access to user memory from the kernel.
+
+   These functions check only that the user range lies below
+   PHYS_BASE, once per call, and then copy with string
+   instructions, a word at a time where they can.  They do not
+   check whether the user pages are mapped.  A user page that is
+   not mapped causes a page fault in kernel mode.  Each
+   instruction that may fault is listed in the fixup table, along
+   with where to resume.  When page_fault() cannot bring the page
+   in, it looks up the faulting instruction with uaccess_fixup()
+   and resumes there, and the copy then reports failure.
+
+   The table is built by the assembler, in section .fixup_table,
+   which the linker script gathers between _start_fixups and
+   _end_fixups. */
+
+/* A fixup table entry. */
+struct fixup
+  {
+    uintptr_t insn;             /* Instruction that may fault. */
+    uintptr_t resume;           /* Where to continue if it does. */
+  };
+
+/* Fixup table, from the linker script. */
+extern const struct fixup _start_fixups[], _end_fixups[];
+
+static bool user_range (const void *uaddr, size_t size);
+static bool copy_user (void *dst, const void *src, size_t size);
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if any of the user
+   bytes are not mapped or not user memory, in which case DST
+   may have been partly written. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return user_range (usrc, size) && copy_user (dst, usrc, size);
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if any of the user
+   bytes are not mapped, not writable, or not user memory, in
+   which case UDST may have been partly written. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return user_range (udst, size) && copy_user (udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   the SIZE bytes at DST.  Returns the string's length, or SIZE
+   if it does not fit, in which case DST is not null-terminated.
+   Returns -1 if the user string runs into memory that is not
+   mapped or not user memory. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  const char *src = usrc;
+  char *d = dst;
+  size_t cnt;
+  int failed;
+
+  ASSERT (size <= INT32_MAX);
+
+  if (!is_user_vaddr (usrc))
+    return -1;
+  cnt = (size_t) ((const char *) PHYS_BASE - usrc);
+  if (cnt > size)
+    cnt = size;
+  if (cnt == 0)
+    return size == 0 ? 0 : -1;
+
+  asm volatile ("        xorl %0, %0\n"
+                "1:      lodsb\n"
+                "        stosb\n"
+                "        testb %%al, %%al\n"
+                "        jz 3f\n"
+                "        loop 1b\n"
+                "        jmp 3f\n"
+                "2:      movl $1, %0\n"
+                "3:\n"
+                "        .section .fixup_table, \"a\"\n"
+                "        .long 1b, 2b\n"
+                "        .previous"
+                : "=&r" (failed), "+S" (src), "+D" (d), "+c" (cnt)
+                : : "eax", "cc", "memory");
+  if (failed)
+    return -1;
+
+  /* Stopped at the end of user memory without a terminator? */
+  if (d[-1] != '\0' && (size_t) (d - dst) < size)
+    return -1;
+  return d[-1] == '\0' ? d - dst - 1 : (int) size;
+}
+
+/* Returns the address to resume at if the instruction at EIP
+   faults on user memory, or 0 if there is none. */
+uintptr_t
+uaccess_fixup (uintptr_t eip)
+{
+  const struct fixup *f;
+
+  for (f = _start_fixups; f < _end_fixups; f++)
+    if (f->insn == eip)
+      return f->resume;
+  return 0;
+}
+
+/* Returns true if the SIZE bytes starting at UADDR lie entirely
+   in user memory. */
+static bool
+user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+
+  return start < (uintptr_t) PHYS_BASE
+         && size <= (uintptr_t) PHYS_BASE - start;
+}
+
+/* Copies SIZE bytes from SRC to DST, one of which is user
+   memory, a word at a time and then the last few bytes one at a
+   time.  Returns false if the user memory faulted. */
+static bool
+copy_user (void *dst, const void *src, size_t size)
+{
+  size_t words = size / sizeof (uint32_t);
+  size_t bytes = size % sizeof (uint32_t);
+  int failed;
+
+  asm volatile ("        xorl %0, %0\n"
+                "1:      rep movsl\n"
+                "        movl %4, %%ecx\n"
+                "2:      rep movsb\n"
+                "        jmp 4f\n"
+                "3:      movl $1, %0\n"
+                "4:\n"
+                "        .section .fixup_table, \"a\"\n"
+                "        .long 1b, 3b\n"
+                "        .long 2b, 3b\n"
+                "        .previous"
+                : "=&r" (failed), "+S" (src), "+D" (dst), "+c" (words)
+                : "g" (bytes)
+                : "cc", "memory");
+  return !failed;
+}
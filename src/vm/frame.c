@@ -0,0 +1,621 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/interrupt.h"
+#include "threads/kmap.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+
+/* Frame table.
+
+   Every frame that holds user pages is on frame_list, along with
+   the list of pages that share it: usually one, more after
+   fork().  When palloc has no frame left for a new page, the
+   clock hand sweeps the list for victims: a frame whose pages
+   have an accessed bit set gets a second chance and has the bits
+   cleared, and frames found with all bits clear are evicted.  Up
+   to SWAP_CLUSTER victims are evicted together, so that the
+   dirty ones can be written to swap in one transfer; the frames
+   not needed right away go back to palloc for the next faults.
+
+   Faulting threads should rarely have to do that themselves,
+   though.  The pageout daemon wakes up when the frames left for
+   user pages drop below frame_low_wm and runs the same clock,
+   batch by batch, until frame_high_wm frames are free again, so
+   that most faults find a frame waiting for them.  A fault that
+   finds none and has to evict on its own counts as a stall.
+
+   A frame that has just been allocated is not on frame_list
+   until frame_install() puts it there, so its owner can fill it
+   in without the clock seeing it.
+
+   frame_lock protects the list, the hand, every frame's list of
+   pages, and every page's BUSY flag.  A page is busy while it is
+   being read in, written out, or used by the kernel in a way
+   that cannot tolerate a fault.  Only the thread that made it
+   busy may touch the page or its frame; everyone else waits in
+   frame_pin() or, in the clock's case, skips it.  A frame is
+   evicted only if all of its pages are idle, so pinning any one
+   of them keeps the frame in place.
+
+   Frames that hold read-only pages of executables are also
+   entered in the text cache, keyed by the executable's inode
+   sector and the offset and length of the data read from it, so
+   that every process running the same program maps the same
+   frames for its code instead of reading its own copy.  Like the
+   frame table, the text cache is protected by frame_lock.
+
+   Pages that are meant to start out as zeros all map one frame
+   of zeros, read-only, until they are first written.  That frame
+   is never on frame_list, so it is never evicted, and it is
+   never freed. */
+
+static struct list frame_list;
+static struct list_elem *clock_hand;
+static struct lock frame_lock;
+static struct condition frame_unbusy;
+
+static struct frame *zero_frame;
+
+/* Free user frame watermarks for the pageout daemon.  Zero
+   means to pick a default in frame_init().  Controlled by kernel
+   command-line options "-lwm" and "-hwm". */
+size_t frame_low_wm;
+size_t frame_high_wm;
+
+static struct semaphore pageout_sema;   /* Upped to wake the daemon. */
+static bool pageout_awake;              /* Daemon woken, not done yet. */
+static unsigned long long pageout_wakeups;  /* Times daemon woke. */
+static unsigned long long pageout_frames;   /* Frames it freed. */
+static unsigned long long stall_cnt;        /* Faults that evicted. */
+
+static struct hash text_cache;
+static unsigned long long text_hits;    /* Text pages found in cache. */
+static unsigned long long text_misses;  /* Text pages read from disk. */
+
+static struct frame *evict (void);
+static size_t reclaim (struct frame *freed[]);
+static thread_func pageout_daemon NO_RETURN;
+static void pageout_wake (void);
+static void install (struct frame *, struct page *);
+static void set_text_key (struct frame *, const struct page *);
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+static bool frame_busy (struct frame *);
+static bool frame_accessed (struct frame *, struct pagedir_batch *);
+static void frame_set_busy (struct frame *, bool);
+static struct frame *clock_next (void);
+static void remove_frame (struct frame *);
+
+/* Initializes the frame table. */
+void
+frame_init (void)
+{
+  void *kpage;
+
+  list_init (&frame_list);
+  clock_hand = NULL;
+  lock_init (&frame_lock);
+  cond_init (&frame_unbusy);
+  hash_init (&text_cache, text_hash, text_less, NULL);
+
+  zero_frame = frame_try_alloc ();
+  if (zero_frame == NULL)
+    PANIC ("frame_init: out of memory");
+  kpage = kmap (zero_frame->paddr);
+  memset (kpage, 0, PGSIZE);
+  kunmap (kpage);
+
+  /* Start reclaiming when 1/32 of user memory is left, stop at
+     twice that, unless told otherwise. */
+  if (frame_low_wm == 0)
+    frame_low_wm = palloc_user_free_cnt () / 32;
+  if (frame_high_wm == 0)
+    frame_high_wm = 2 * frame_low_wm;
+  if (frame_high_wm < frame_low_wm)
+    frame_high_wm = frame_low_wm;
+
+  sema_init (&pageout_sema, 0);
+  pageout_awake = false;
+  if (thread_create ("pageout", PRI_DEFAULT, pageout_daemon, NULL)
+      == TID_ERROR)
+    PANIC ("frame_init: cannot start pageout daemon");
+}
+
+/* Returns a frame for the caller to fill in and then pass to
+   frame_install() or frame_free(), evicting some pages if no
+   free frame is left.  The frame's contents are garbage.
+   Returns a null pointer if no frame can be found. */
+struct frame *
+frame_alloc (void)
+{
+  struct frame *f = frame_try_alloc ();
+  if (f != NULL)
+    return f;
+
+  lock_acquire (&frame_lock);
+  stall_cnt++;
+  lock_release (&frame_lock);
+  return evict ();
+}
+
+/* Like frame_alloc(), but returns a null pointer instead of
+   evicting anything. */
+struct frame *
+frame_try_alloc (void)
+{
+  struct frame *f;
+  uintptr_t paddr;
+
+  paddr = palloc_get_frame (PAL_USER);
+  if (palloc_user_free_cnt () < frame_low_wm)
+    pageout_wake ();
+  if (paddr == 0)
+    return NULL;
+
+  f = malloc (sizeof *f);
+  if (f == NULL)
+    {
+      palloc_free_frame (paddr);
+      return NULL;
+    }
+  f->paddr = paddr;
+  list_init (&f->pages);
+  f->text = false;
+  return f;
+}
+
+/* Frees frame F, which must not be in the frame table. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (list_empty (&f->pages));
+
+  palloc_free_frame (f->paddr);
+  free (f);
+}
+
+/* Adds frame F, obtained from frame_alloc(), to the frame table
+   as the frame of page P, which must be pinned. */
+void
+frame_install (struct frame *f, struct page *p)
+{
+  lock_acquire (&frame_lock);
+  install (f, p);
+  lock_release (&frame_lock);
+}
+
+/* Like frame_install(), but also enters F in the text cache for
+   other processes running the same executable to find, with
+   frame_share_text().  P must be a PAGE_FILE page that is not
+   writable, and F must hold its contents. */
+void
+frame_install_text (struct frame *f, struct page *p)
+{
+  ASSERT (p->type == PAGE_FILE && !p->writable);
+
+  set_text_key (f, p);
+  lock_acquire (&frame_lock);
+  install (f, p);
+  f->text = hash_insert (&text_cache, &f->text_elem) == NULL;
+  lock_release (&frame_lock);
+}
+
+/* Looks in the text cache for a frame holding the contents of
+   page P, which must be pinned and not resident, and makes P
+   share it.  Returns the frame, or a null pointer if there is
+   none or it might be on its way out. */
+struct frame *
+frame_share_text (struct page *p)
+{
+  struct frame key;
+  struct frame *f = NULL;
+  struct hash_elem *e;
+
+  ASSERT (p->busy);
+
+  set_text_key (&key, p);
+  lock_acquire (&frame_lock);
+  e = hash_find (&text_cache, &key.text_elem);
+  if (e != NULL)
+    {
+      /* A frame with a busy page may be in the middle of being
+         evicted, which we cannot tell from being pinned. */
+      f = hash_entry (e, struct frame, text_elem);
+      if (frame_busy (f))
+        f = NULL;
+      else
+        list_push_back (&f->pages, &p->frame_elem);
+    }
+  if (f != NULL)
+    text_hits++;
+  else
+    text_misses++;
+  lock_release (&frame_lock);
+
+  return f;
+}
+
+/* Makes page P, which must be pinned and not resident, share
+   the zero frame, and returns that frame. */
+struct frame *
+frame_share_zero (struct page *p)
+{
+  ASSERT (p->busy);
+
+  lock_acquire (&frame_lock);
+  list_push_back (&zero_frame->pages, &p->frame_elem);
+  lock_release (&frame_lock);
+
+  return zero_frame;
+}
+
+/* Adds page P to the pages that share frame F, which is kept in
+   place by some other pinned page. */
+void
+frame_share (struct frame *f, struct page *p)
+{
+  lock_acquire (&frame_lock);
+  ASSERT (!list_empty (&f->pages));
+  list_push_back (&f->pages, &p->frame_elem);
+  lock_release (&frame_lock);
+}
+
+/* Returns true if more than one page shares frame F, which must
+   be kept in place by a pinned page, or if F is the zero frame,
+   which must never be written. */
+bool
+frame_is_shared (struct frame *f)
+{
+  bool shared;
+
+  lock_acquire (&frame_lock);
+  shared = (f == zero_frame
+            || list_begin (&f->pages) != list_rbegin (&f->pages));
+  lock_release (&frame_lock);
+
+  return shared;
+}
+
+/* Removes page P, which must be pinned and already unmapped,
+   from the pages that share frame F.  If P was the last of them,
+   removes F from the frame table and frees it, unless F is the
+   zero frame. */
+void
+frame_release (struct frame *f, struct page *p)
+{
+  bool last;
+
+  ASSERT (p->busy);
+
+  lock_acquire (&frame_lock);
+  list_remove (&p->frame_elem);
+  last = list_empty (&f->pages) && f != zero_frame;
+  if (last)
+    remove_frame (f);
+  lock_release (&frame_lock);
+
+  if (last)
+    frame_free (f);
+}
+
+/* Prints frame table statistics. */
+void
+frame_print_stats (void)
+{
+  lock_acquire (&frame_lock);
+  printf ("Frames: %zu in use, %zu in text cache, "
+          "%llu text pages shared, %llu read, "
+          "%zu pages on zero frame\n",
+          list_size (&frame_list), hash_size (&text_cache),
+          text_hits, text_misses, list_size (&zero_frame->pages));
+  printf ("  pageout: %zu frames free, watermarks %zu/%zu, "
+          "%llu wakeups, %llu frames freed, %llu fault stalls\n",
+          palloc_user_free_cnt (), frame_low_wm, frame_high_wm,
+          pageout_wakeups, pageout_frames, stall_cnt);
+  lock_release (&frame_lock);
+}
+
+/* Marks page P busy, first waiting for whoever else has it busy
+   to finish.  Returns true if P is resident, false otherwise. */
+bool
+frame_pin (struct page *p)
+{
+  bool resident;
+
+  lock_acquire (&frame_lock);
+  while (p->busy)
+    cond_wait (&frame_unbusy, &frame_lock);
+  p->busy = true;
+  resident = p->frame != NULL;
+  lock_release (&frame_lock);
+
+  return resident;
+}
+
+/* Marks page P busy, like frame_pin(), but only if nobody else
+   has it busy.  Returns true if successful. */
+bool
+frame_try_pin (struct page *p)
+{
+  bool success;
+
+  lock_acquire (&frame_lock);
+  success = !p->busy;
+  if (success)
+    p->busy = true;
+  lock_release (&frame_lock);
+
+  return success;
+}
+
+/* Marks page P, which the caller pinned, no longer busy. */
+void
+frame_unpin (struct page *p)
+{
+  lock_acquire (&frame_lock);
+  ASSERT (p->busy);
+  p->busy = false;
+  cond_broadcast (&frame_unbusy, &frame_lock);
+  lock_release (&frame_lock);
+}
+
+/* Evicts up to SWAP_CLUSTER frames chosen by the clock algorithm
+   and returns one of them, out of the frame table.  Returns a
+   null pointer if every frame is busy or none can be written
+   out. */
+static struct frame *
+evict (void)
+{
+  struct frame *freed[SWAP_CLUSTER];
+  size_t cnt = reclaim (freed);
+  size_t i;
+
+  /* Keep one frame for the caller and release the rest. */
+  for (i = 1; i < cnt; i++)
+    frame_free (freed[i]);
+  return cnt > 0 ? freed[0] : NULL;
+}
+
+/* Evicts up to SWAP_CLUSTER frames chosen by the clock algorithm,
+   stores the ones that were freed, now out of the frame table,
+   into FREED, and returns how many there are. */
+static size_t
+reclaim (struct frame *freed[])
+{
+  struct frame *victims[SWAP_CLUSTER];
+  struct pagedir_batch batch;
+  size_t cnt = 0, freed_cnt = 0;
+  size_t tries, i;
+
+  /* Pick the victims.  Two sweeps: the first may only clear
+     accessed bits.  Only the running process's page directory
+     can have TLB entries to invalidate, and those are
+     invalidated together once the sweep is done. */
+  pagedir_batch_init (&batch, thread_current ()->pagedir);
+  lock_acquire (&frame_lock);
+  for (tries = 2 * list_size (&frame_list); tries > 0 && cnt < SWAP_CLUSTER;
+       tries--)
+    {
+      struct frame *f = clock_next ();
+
+      if (frame_busy (f) || frame_accessed (f, &batch))
+        continue;
+      frame_set_busy (f, true);
+      victims[cnt++] = f;
+    }
+  pagedir_batch_finish (&batch);
+  lock_release (&frame_lock);
+  if (cnt == 0)
+    return 0;
+
+  /* Write them out without holding the lock, so that faults on
+     other pages can proceed meanwhile. */
+  page_out (victims, cnt);
+
+  /* A frame that could not be written out stays with its
+     pages. */
+  lock_acquire (&frame_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      struct frame *f = victims[i];
+      struct page *p = list_entry (list_front (&f->pages),
+                                   struct page, frame_elem);
+      bool resident = p->frame != NULL;
+
+      frame_set_busy (f, false);
+      if (resident)
+        continue;
+      list_init (&f->pages);
+      remove_frame (f);
+      freed[freed_cnt++] = f;
+    }
+  cond_broadcast (&frame_unbusy, &frame_lock);
+  lock_release (&frame_lock);
+
+  return freed_cnt;
+}
+
+/* Pageout daemon.  Each time it is woken, evicts frames in
+   batches until frame_high_wm frames are free for user pages or
+   nothing more can be evicted. */
+static void
+pageout_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      struct frame *freed[SWAP_CLUSTER];
+      enum intr_level old_level;
+      size_t cnt, i;
+
+      sema_down (&pageout_sema);
+      pageout_wakeups++;
+
+      while (palloc_user_free_cnt () < frame_high_wm
+             && (cnt = reclaim (freed)) > 0)
+        {
+          for (i = 0; i < cnt; i++)
+            frame_free (freed[i]);
+          pageout_frames += cnt;
+        }
+
+      old_level = intr_disable ();
+      pageout_awake = false;
+      intr_set_level (old_level);
+    }
+}
+
+/* Wakes up the pageout daemon, unless it is already at work. */
+static void
+pageout_wake (void)
+{
+  enum intr_level old_level = intr_disable ();
+  if (!pageout_awake)
+    {
+      pageout_awake = true;
+      sema_up (&pageout_sema);
+    }
+  intr_set_level (old_level);
+}
+
+/* Adds frame F to the frame table as the frame of page P, which
+   must be pinned.  frame_lock must be held. */
+static void
+install (struct frame *f, struct page *p)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (p->busy);
+  ASSERT (list_empty (&f->pages));
+
+  list_push_back (&f->pages, &p->frame_elem);
+  list_push_back (&frame_list, &f->elem);
+}
+
+/* Sets F's text cache key to that of PAGE_FILE page P. */
+static void
+set_text_key (struct frame *f, const struct page *p)
+{
+  f->sector = inode_get_inumber (file_get_inode (p->file));
+  f->ofs = p->file_ofs;
+  f->read_bytes = p->read_bytes;
+}
+
+/* Returns a hash value for text cache frame E. */
+static unsigned
+text_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, text_elem);
+  return hash_int (f->sector) ^ hash_int (f->ofs);
+}
+
+/* Returns true if text cache frame A precedes frame B. */
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, text_elem);
+  const struct frame *b = hash_entry (b_, struct frame, text_elem);
+
+  if (a->sector != b->sector)
+    return a->sector < b->sector;
+  if (a->ofs != b->ofs)
+    return a->ofs < b->ofs;
+  return a->read_bytes < b->read_bytes;
+}
+
+/* Returns true if any page that shares frame F is busy.
+   frame_lock must be held. */
+static bool
+frame_busy (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    if (list_entry (e, struct page, frame_elem)->busy)
+      return true;
+  return false;
+}
+
+/* Returns true if any page that shares frame F was accessed
+   since the last call, and clears their accessed bits.  Pages in
+   B's page directory are cleared through B, so their TLB entries
+   are invalidated only by pagedir_batch_finish().
+   frame_lock must be held. */
+static bool
+frame_accessed (struct frame *f, struct pagedir_batch *b)
+{
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_accessed (p->pagedir, p->upage))
+        {
+          if (p->pagedir == b->pd)
+            pagedir_batch_set_accessed (b, p->upage, false);
+          else
+            pagedir_set_accessed (p->pagedir, p->upage, false);
+          accessed = true;
+        }
+    }
+  return accessed;
+}
+
+/* Sets the BUSY flag of every page that shares frame F.
+   frame_lock must be held. */
+static void
+frame_set_busy (struct frame *f, bool busy)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    list_entry (e, struct page, frame_elem)->busy = busy;
+}
+
+/* Returns the frame under the clock hand and advances the hand.
+   The frame table must not be empty.  frame_lock must be held. */
+static struct frame *
+clock_next (void)
+{
+  struct frame *f;
+
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+  ASSERT (!list_empty (&frame_list));
+
+  if (clock_hand == NULL || clock_hand == list_end (&frame_list))
+    clock_hand = list_begin (&frame_list);
+  f = list_entry (clock_hand, struct frame, elem);
+  clock_hand = list_next (clock_hand);
+  return f;
+}
+
+/* Removes frame F from the frame table and the text cache,
+   moving the clock hand off it if necessary.  frame_lock must be
+   held. */
+static void
+remove_frame (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&frame_lock));
+
+  if (f->text)
+    {
+      hash_delete (&text_cache, &f->text_elem);
+      f->text = false;
+    }
+  if (clock_hand == &f->elem)
+    clock_hand = list_next (clock_hand);
+  list_remove (&f->elem);
+}
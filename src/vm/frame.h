@@ -0,0 +1,55 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+struct page;
+
+/* A physical frame that holds a user page.  After fork(), the
+   same page of several processes may share one frame until one
+   of them writes to it.  Read-only pages of an executable are
+   shared by every process that runs it. */
+struct frame
+  {
+    struct list_elem elem;      /* Element in frame table. */
+    uintptr_t paddr;            /* Physical address. */
+    struct list pages;          /* Pages sharing the frame. */
+
+    /* Text cache; see frame_install_text(). */
+    bool text;                  /* In the text cache? */
+    struct hash_elem text_elem; /* Element in text cache. */
+    block_sector_t sector;      /* Executable's inode sector. */
+    off_t ofs;                  /* Offset in executable. */
+    uint32_t read_bytes;        /* Bytes read from executable. */
+  };
+
+/* Free user frame watermarks for the pageout daemon.
+   Controlled by kernel command-line options "-lwm" and "-hwm". */
+extern size_t frame_low_wm;
+extern size_t frame_high_wm;
+
+void frame_init (void);
+struct frame *frame_alloc (void);
+struct frame *frame_try_alloc (void);
+void frame_free (struct frame *);
+void frame_install (struct frame *, struct page *);
+void frame_install_text (struct frame *, struct page *);
+struct frame *frame_share_text (struct page *);
+struct frame *frame_share_zero (struct page *);
+void frame_share (struct frame *, struct page *);
+bool frame_is_shared (struct frame *);
+void frame_release (struct frame *, struct page *);
+
+bool frame_pin (struct page *);
+bool frame_try_pin (struct page *);
+void frame_unpin (struct page *);
+
+void frame_print_stats (void);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,1069 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "threads/kmap.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+
+/* Supplemental page table.
+
+   Each process keeps a hash table of struct page, keyed by user
+   virtual page, that records where every page of its address
+   space comes from.  load() fills it in instead of reading the
+   executable up front, and page_in() reads a page only when the
+   process first touches it, so starting a large program costs
+   about as much as the part of it that actually runs.
+
+   When memory runs out, the frame table evicts pages through
+   page_out().  A page that was modified goes to swap, unless it
+   maps part of a file, in which case it is written back to the
+   file; any other page is simply dropped, because it can be read
+   again from its file or zeroed again.
+
+   fork() copies the table without copying any page: the
+   child's pages share the parent's frames and swap slots, mapped
+   read-only in both processes, until one of them writes.  The
+   write faults, and page_lock() then gives the writer a private
+   copy of the frame, or just write access if nobody else shares
+   it any longer.  Since shared pages cannot be written, all the
+   pages that share a frame have the same dirty bit, which
+   page_table_fork() copies along with the mapping.
+
+   A PAGE_ZERO page that is read before it is written maps the
+   frame table's zero frame, read-only, so that a program that
+   reserves a big zeroed array but reads little of it uses little
+   memory.  The first write gives it a frame of its own in the
+   same way as for fork().
+
+   A fault also maps a few of the following pages ahead of use,
+   as long as that takes neither eviction nor swap I/O, so that a
+   process scanning a file mapping or a big array sequentially
+   does not take a fault for every page.  Those that come from
+   consecutive parts of the same file are read together, with
+   one transfer into a bounce buffer.  How many depends on how
+   many of those mapped by the previous fault were used since, as
+   their accessed bits tell.
+
+   The stack starts out as a single page and grows on demand:
+   an access to an unrecorded page within page_stack_max bytes of
+   PHYS_BASE counts as stack growth if it is not too far below the
+   stack pointer the process had when it last entered the kernel.
+   That stack pointer is saved in the thread by the page fault and
+   system call handlers, because a fault taken in kernel mode, on
+   a user buffer passed to a system call, has only the kernel's
+   own stack pointer in its interrupt frame.
+
+   Each process keeps statistics on its page faults and on where
+   the pages it brought in came from, along with an estimate of
+   its working set: the number of its pages accessed between two
+   samples, taken at most every WS_INTERVAL ticks when it faults.
+   They are printed when it exits if the "-faults" kernel
+   command-line option is given, and a process can get its own
+   with the get_fault_stats() system call. */
+
+/* The 80x86 PUSHA instruction checks access permissions before
+   it adjusts the stack pointer, so it may fault this many bytes
+   below the stack pointer.  No other instruction faults further
+   down. */
+#define STACK_SLOP 32
+
+/* Bounds and starting value for the fault-around window. */
+#define AROUND_MIN 1
+#define AROUND_MAX 16
+#define AROUND_START 4
+
+/* Minimum time between working set samples, in timer ticks. */
+#define WS_INTERVAL (TIMER_FREQ / 10)
+
+size_t page_stack_max = STACK_MAX_DEFAULT;
+bool page_report_faults;
+
+static hash_hash_func page_hash;
+static hash_less_func page_less;
+static hash_action_func page_destructor;
+static void page_free (struct page *);
+static void page_drop (struct page *);
+static void write_back (struct page *);
+static struct page *page_add (void *upage, bool writable,
+                              enum page_type);
+static void fault_around (uint8_t *upage);
+static void read_around (struct page *run[], struct frame *frames[],
+                         size_t cnt);
+static bool continues (const struct page *, const struct page *);
+static bool map_loaded (struct page *, struct frame *);
+static void sample_working_set (void);
+static bool page_load (struct page *, bool write, bool evict);
+static bool map_shared (struct page *, struct frame *);
+static bool page_unshare (struct page *);
+static void load_from_swap (struct page *, struct frame *);
+static struct page *grab_neighbour (const struct page *, int delta,
+                                    struct frame **);
+static bool page_precedes (const struct page *, const struct page *);
+static struct page *first_page (struct frame *);
+static bool unmap_frame (struct frame *);
+static void map_frame (struct frame *, bool dirty);
+static void drop_frame (struct frame *);
+/* Bounce buffer of AROUND_MAX pages for fault_around(), and
+   its lock. */
+static uint8_t *around_buffer;
+static struct lock around_lock;
+
+static void write_run (struct frame *frames[], size_t cnt, size_t slot);
+
+/* Initializes the page module. */
+void
+page_init (void)
+{
+  around_buffer = palloc_get_multiple (0, AROUND_MAX);
+  if (around_buffer == NULL)
+    PANIC ("page_init: out of memory");
+  lock_init (&around_lock);
+}
+
+/* Initializes the running process's supplemental page table. */
+void
+page_table_init (void)
+{
+  struct thread *t = thread_current ();
+
+  if (!hash_init (&t->pages, page_hash, page_less, NULL))
+    PANIC ("page_table_init: out of memory");
+  t->user_esp = PHYS_BASE;
+  t->around_cnt = 0;
+  t->around_max = AROUND_START;
+  memset (&t->faults, 0, sizeof t->faults);
+  t->ws_sampled = timer_ticks ();
+}
+
+/* Frees the running process's supplemental page table, along
+   with its pages' frames and swap slots, except as other
+   processes still share them. */
+void
+page_table_destroy (void)
+{
+  hash_destroy (&thread_current ()->pages, page_destructor);
+}
+
+/* Fills the running process's supplemental page table, which
+   must be empty, with a copy of PARENT's, for fork().  PARENT
+   must stay blocked meanwhile.  Resident pages are not copied
+   but share the parent's frame, and swapped-out pages share its
+   swap slot.  The child's PAGE_FILE pages read from EXEC_FILE,
+   its own handle on the executable.  PAGE_MMAP pages are left
+   out, because mappings are not inherited.  Returns true if
+   successful, false if memory ran out. */
+bool
+page_table_fork (struct thread *parent, struct file *exec_file)
+{
+  struct hash_iterator i;
+
+  thread_current ()->user_esp = parent->user_esp;
+
+  hash_first (&i, &parent->pages);
+  while (hash_next (&i))
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
+      struct page *c;
+      bool ok = true;
+
+      if (p->type == PAGE_MMAP)
+        continue;
+      c = page_add (p->upage, p->writable, p->type);
+      if (c == NULL)
+        return false;
+      if (p->type == PAGE_FILE)
+        {
+          c->file = exec_file;
+          c->file_ofs = p->file_ofs;
+          c->read_bytes = p->read_bytes;
+          c->zero_bytes = p->zero_bytes;
+        }
+
+      if (frame_pin (p))
+        {
+          ok = pagedir_set_frame (c->pagedir, c->upage, p->frame->paddr,
+                                  false);
+          if (ok)
+            {
+              if (pagedir_is_dirty (p->pagedir, p->upage))
+                pagedir_set_dirty (c->pagedir, c->upage, true);
+              pagedir_set_writable (p->pagedir, p->upage, false);
+              c->frame = p->frame;
+              frame_share (p->frame, c);
+            }
+        }
+      else if (p->swap_slot != SWAP_NONE)
+        {
+          c->swap_slot = p->swap_slot;
+          swap_share (c->swap_slot);
+        }
+      frame_unpin (p);
+      if (!ok)
+        return false;
+    }
+  return true;
+}
+
+/* Records that user page UPAGE of the running process is to be
+   filled with READ_BYTES bytes read from FILE starting at offset
+   OFS, followed by zeros up to a full page.  Returns the new
+   page, or a null pointer if UPAGE is already in use or memory
+   is short. */
+struct page *
+page_add_file (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes, bool writable)
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = page_add (upage, writable, PAGE_FILE);
+  if (p != NULL)
+    {
+      p->file = file;
+      p->file_ofs = ofs;
+      p->read_bytes = read_bytes;
+      p->zero_bytes = PGSIZE - read_bytes;
+    }
+  return p;
+}
+
+/* Records that user page UPAGE of the running process is to be
+   filled with zeros.  Returns the new page, or a null pointer if
+   UPAGE is already in use or memory is short. */
+struct page *
+page_add_zero (void *upage, bool writable)
+{
+  return page_add (upage, writable, PAGE_ZERO);
+}
+
+/* Records that user page UPAGE of the running process maps the
+   READ_BYTES bytes of FILE starting at offset OFS, followed by
+   zeros up to a full page.  Unlike a PAGE_FILE page, the page is
+   written back to FILE instead of to swap if it is modified.
+   Returns the new page, or a null pointer if UPAGE is already in
+   use or memory is short. */
+struct page *
+page_add_mmap (void *upage, struct file *file, off_t ofs,
+               uint32_t read_bytes)
+{
+  struct page *p;
+
+  ASSERT (read_bytes <= PGSIZE);
+
+  p = page_add (upage, true, PAGE_MMAP);
+  if (p != NULL)
+    {
+      p->file = file;
+      p->file_ofs = ofs;
+      p->read_bytes = read_bytes;
+      p->zero_bytes = PGSIZE - read_bytes;
+    }
+  return p;
+}
+
+/* Removes the running process's page at UPAGE, which must exist,
+   from its supplemental page table and frees it.  If it is a
+   modified PAGE_MMAP page, writes it back to its file first. */
+void
+page_remove (void *upage)
+{
+  struct page *p = page_lookup (upage);
+
+  ASSERT (p != NULL);
+
+  hash_delete (&thread_current ()->pages, &p->hash_elem);
+  page_free (p);
+}
+
+/* Removes the running process's PAGE_CNT pages starting at
+   UPAGE, which must all exist, as page_remove() would.  Unmaps
+   them PAGEDIR_BATCH_MAX at a time and invalidates their TLB
+   entries together before dropping their frames. */
+void
+page_remove_range (void *upage, size_t page_cnt)
+{
+  struct thread *t = thread_current ();
+  struct page *pages[PAGEDIR_BATCH_MAX];
+  struct pagedir_batch batch;
+  size_t i, j, cnt;
+
+  pagedir_batch_init (&batch, t->pagedir);
+  for (i = 0; i < page_cnt; i += cnt)
+    {
+      cnt = page_cnt - i;
+      if (cnt > PAGEDIR_BATCH_MAX)
+        cnt = PAGEDIR_BATCH_MAX;
+
+      for (j = 0; j < cnt; j++)
+        {
+          struct page *p = page_lookup ((uint8_t *) upage
+                                        + (i + j) * PGSIZE);
+
+          ASSERT (p != NULL);
+          hash_delete (&t->pages, &p->hash_elem);
+          if (frame_pin (p))
+            pagedir_batch_clear_page (&batch, p->upage);
+          pages[j] = p;
+        }
+      pagedir_batch_finish (&batch);
+
+      for (j = 0; j < cnt; j++)
+        page_drop (pages[j]);
+    }
+}
+
+/* Returns the running process's page that contains user virtual
+   address UADDR, or a null pointer if there is none. */
+struct page *
+page_lookup (const void *uaddr)
+{
+  struct thread *t = thread_current ();
+  struct page p;
+  struct hash_elem *e;
+
+  if (t->pagedir == NULL || !is_user_vaddr (uaddr))
+    return NULL;
+
+  p.upage = pg_round_down (uaddr);
+  e = hash_find (&t->pages, &p.hash_elem);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Returns true if an access to user address UADDR by the running
+   process should be taken as growing its stack. */
+bool
+page_is_stack (const void *uaddr)
+{
+  const uint8_t *addr = uaddr;
+  const uint8_t *esp = thread_current ()->user_esp;
+
+  return (is_user_vaddr (addr)
+          && addr >= (uint8_t *) PHYS_BASE - page_stack_max
+          && addr + STACK_SLOP >= esp);
+}
+
+/* Brings the page containing FAULT_ADDR into memory and maps it
+   in the running process's page directory.  WRITE is true if the
+   faulting access was a write.  Returns true if successful,
+   false if FAULT_ADDR does not belong to the process, may not be
+   accessed that way, or cannot be read in. */
+bool
+page_in (const void *fault_addr, bool write)
+{
+  if (!page_lock (fault_addr, write))
+    return false;
+  page_unlock (fault_addr);
+  fault_around (pg_round_down (fault_addr));
+  if (timer_elapsed (thread_current ()->ws_sampled) >= WS_INTERVAL)
+    sample_working_set ();
+  return true;
+}
+
+/* Prints the running process's page fault statistics, after
+   taking a last working set sample. */
+void
+page_print_faults (void)
+{
+  struct thread *t = thread_current ();
+  const struct fault_stats *s = &t->faults;
+
+  sample_working_set ();
+  printf ("%s: faults: %u not present, %u protection, %llu cycles; "
+          "pages in: %u stack, %u file, %u swap, %u zero; "
+          "working set: %u pages, peak %u, %u samples\n",
+          t->name, s->not_present, s->protection, s->cycles,
+          s->stack, s->file, s->swap, s->zero,
+          s->ws_pages, s->ws_peak, s->ws_samples);
+}
+
+/* Counts the running process's pages that were accessed since
+   the last sample, as its working set estimate. */
+static void
+sample_working_set (void)
+{
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+  unsigned cnt = 0;
+
+  hash_first (&i, &t->pages);
+  while (hash_next (&i))
+    {
+      struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
+      if (pagedir_sample_accessed (t->pagedir, p->upage))
+        cnt++;
+    }
+
+  t->faults.ws_pages = cnt;
+  if (cnt > t->faults.ws_peak)
+    t->faults.ws_peak = cnt;
+  t->faults.ws_samples++;
+  t->ws_sampled = timer_ticks ();
+}
+
+/* Maps pages following UPAGE, which was just faulted in, ahead
+   of use.  First adjusts the window size according to how many
+   of the pages mapped by the previous call were accessed since:
+   doubles it if at least half were, halves it otherwise. */
+static void
+fault_around (uint8_t *upage)
+{
+  struct thread *t = thread_current ();
+  struct page *run[AROUND_MAX];
+  struct frame *frames[AROUND_MAX];
+  size_t run_cnt = 0;
+  size_t i;
+
+  if (t->around_cnt > 0)
+    {
+      size_t used = 0;
+
+      for (i = 0; i < t->around_cnt; i++)
+        if (pagedir_is_accessed (t->pagedir, t->around_base + i * PGSIZE))
+          used++;
+      if (used * 2 >= t->around_cnt)
+        t->around_max = t->around_max * 2 < AROUND_MAX
+                        ? t->around_max * 2 : AROUND_MAX;
+      else
+        t->around_max = t->around_max / 2 > AROUND_MIN
+                        ? t->around_max / 2 : AROUND_MIN;
+    }
+
+  /* Pages already in memory are passed over.  Zero pages and
+     pages in the text cache are mapped at once.  Other file
+     pages are gathered into a run that read_around() reads with
+     a single transfer, so each one must continue the file data
+     of the one before.  Stop at the first page that is not
+     there, is in swap (readahead covers that), is busy, has no
+     free frame to go to, or would need a second transfer. */
+  for (i = 0; i < t->around_max; i++)
+    {
+      struct page *q = page_lookup (upage + (i + 1) * PGSIZE);
+      struct frame *f;
+      bool ok;
+
+      if (q == NULL || q->swap_slot != SWAP_NONE || !frame_try_pin (q))
+        break;
+      if (q->frame != NULL)
+        ok = true;
+      else if (q->swap_slot != SWAP_NONE)
+        ok = false;
+      else if (q->type == PAGE_FILE && !q->writable
+               && (f = frame_share_text (q)) != NULL)
+        {
+          t->faults.file++;
+          ok = map_shared (q, f);
+        }
+      else if (q->type == PAGE_ZERO)
+        ok = page_load (q, false, false);
+      else if ((run_cnt > 0 && !continues (run[run_cnt - 1], q))
+               || (f = frame_try_alloc ()) == NULL)
+        ok = false;
+      else
+        {
+          /* Stays pinned until read_around() is done with it. */
+          run[run_cnt] = q;
+          frames[run_cnt++] = f;
+          continue;
+        }
+      frame_unpin (q);
+      if (!ok)
+        break;
+    }
+  read_around (run, frames, run_cnt);
+  t->around_base = upage + PGSIZE;
+  t->around_cnt = i;
+}
+
+/* Returns true if page Q's file data follows on from page P's,
+   so that both can be read with one transfer. */
+static bool
+continues (const struct page *p, const struct page *q)
+{
+  return (q->type != PAGE_ZERO && q->file == p->file
+          && p->read_bytes == PGSIZE
+          && q->file_ofs == p->file_ofs + PGSIZE);
+}
+
+/* Reads the CNT file pages in RUN[], each of which continues
+   the one before, into FRAMES[] with one file_read_at() through
+   the fault-around bounce buffer, and maps them.  The pages must
+   be pinned and are unpinned.  If another process is using the
+   buffer, or the read falls short, drops the pages' frames
+   instead: fault-around is only a guess, and not worth waiting
+   for. */
+static void
+read_around (struct page *run[], struct frame *frames[], size_t cnt)
+{
+  off_t size;
+  bool locked, ok;
+  size_t i;
+
+  if (cnt == 0)
+    return;
+
+  size = (cnt - 1) * PGSIZE + run[cnt - 1]->read_bytes;
+  locked = lock_try_acquire (&around_lock);
+  ok = locked && file_read_at (run[0]->file, around_buffer, size,
+                               run[0]->file_ofs) == size;
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *q = run[i];
+
+      if (ok)
+        {
+          uint8_t *kpage = kmap (frames[i]->paddr);
+          memcpy (kpage, around_buffer + i * PGSIZE, q->read_bytes);
+          memset (kpage + q->read_bytes, 0, q->zero_bytes);
+          kunmap (kpage);
+          thread_current ()->faults.file++;
+          map_loaded (q, frames[i]);
+        }
+      else
+        frame_free (frames[i]);
+      frame_unpin (q);
+    }
+  if (locked)
+    lock_release (&around_lock);
+}
+
+/* Takes the CNT frames in FRAMES[], all of whose pages must be
+   pinned by the caller, away from their pages, so that the
+   caller may reuse them.  A modified PAGE_MMAP page is written
+   back to its file.  Other frames that were modified go to
+   swap, in as few runs of consecutive slots as the swap area
+   allows, and in order of virtual address so that swap-in
+   readahead can find neighbours next to each other.  If swap
+   runs out, the frames that did not fit stay with their pages;
+   the caller can tell them by their pages' non-null FRAME. */
+void
+page_out (struct frame *frames[], size_t cnt)
+{
+  struct frame *dirty[SWAP_CLUSTER];
+  size_t dirty_cnt = 0;
+  size_t i, j;
+
+  ASSERT (cnt <= SWAP_CLUSTER);
+
+  /* Unmap each frame first, so that no process can modify it
+     while it is being written.  Clean frames are done then. */
+  for (i = 0; i < cnt; i++)
+    {
+      struct frame *f = frames[i];
+      struct page *p = first_page (f);
+
+      if (!unmap_frame (f))
+        drop_frame (f);
+      else if (p->type == PAGE_MMAP)
+        {
+          write_back (p);
+          drop_frame (f);
+        }
+      else
+        {
+          /* Insertion sort by process, then address. */
+          for (j = dirty_cnt;
+               j > 0 && page_precedes (p, first_page (dirty[j - 1])); j--)
+            dirty[j] = dirty[j - 1];
+          dirty[j] = f;
+          dirty_cnt++;
+        }
+    }
+
+  /* Write the dirty frames in runs, halving the run length
+     whenever the swap area has no room for it. */
+  i = 0;
+  while (i < dirty_cnt)
+    {
+      size_t run = dirty_cnt - i;
+      size_t slot;
+
+      while ((slot = swap_alloc (run)) == SWAP_NONE && run > 1)
+        run /= 2;
+      if (slot == SWAP_NONE)
+        break;
+      write_run (dirty + i, run, slot);
+      i += run;
+    }
+
+  /* Put back what did not fit. */
+  for (; i < dirty_cnt; i++)
+    map_frame (dirty[i], true);
+}
+
+/* Brings the page containing user address UADDR into memory if
+   it isn't already and pins it there until page_unlock() is
+   called, so that the kernel can access it without faulting.
+   WRITE is true if the page will be written.  Returns true if
+   successful, false if UADDR is not a valid address for that
+   kind of access or the page cannot be read in.  Grows the stack
+   if UADDR is a stack access, as page_is_stack() decides. */
+bool
+page_lock (const void *uaddr, bool write)
+{
+  struct page *p = page_lookup (uaddr);
+
+  if (p == NULL && page_is_stack (uaddr))
+    {
+      p = page_add_zero (pg_round_down (uaddr), true);
+      if (p != NULL)
+        thread_current ()->faults.stack++;
+    }
+
+  if (p == NULL || (write && !p->writable))
+    return false;
+  if (frame_pin (p))
+    {
+      if (write && !page_unshare (p))
+        {
+          frame_unpin (p);
+          return false;
+        }
+      return true;
+    }
+  if (!page_load (p, write, true))
+    {
+      frame_unpin (p);
+      return false;
+    }
+  return true;
+}
+
+/* Unpins the page containing UADDR, which page_lock() pinned. */
+void
+page_unlock (const void *uaddr)
+{
+  frame_unpin (page_lookup (uaddr));
+}
+
+/* Reads page P, which must be pinned and not resident, into a
+   newly obtained frame and maps it.  A read-only page of an
+   executable maps the frame another process already read it
+   into, if there is one, and a page of zeros maps the zero frame
+   unless it is about to be written, as WRITE says.  If EVICT is
+   false, fails rather than evict anything to make room.  Returns
+   true if successful. */
+static bool
+page_load (struct page *p, bool write, bool evict)
+{
+  struct fault_stats *stats = &thread_current ()->faults;
+  bool text = p->type == PAGE_FILE && !p->writable;
+  struct frame *f;
+  uint8_t *kpage;
+  bool ok = true;
+
+  if (text && (f = frame_share_text (p)) != NULL)
+    {
+      stats->file++;
+      return map_shared (p, f);
+    }
+  if (p->type == PAGE_ZERO && !write && p->swap_slot == SWAP_NONE)
+    {
+      stats->zero++;
+      return map_shared (p, frame_share_zero (p));
+    }
+
+  f = evict ? frame_alloc () : frame_try_alloc ();
+  if (f == NULL)
+    return false;
+
+  if (p->swap_slot != SWAP_NONE)
+    {
+      load_from_swap (p, f);
+      return true;
+    }
+
+  kpage = kmap (f->paddr);
+  if (p->type != PAGE_ZERO)
+    {
+      ok = (file_read_at (p->file, kpage, p->read_bytes, p->file_ofs)
+            == (off_t) p->read_bytes);
+      memset (kpage + p->read_bytes, 0, p->zero_bytes);
+      stats->file++;
+    }
+  else
+    {
+      memset (kpage, 0, PGSIZE);
+      stats->zero++;
+    }
+  kunmap (kpage);
+
+  if (!ok)
+    {
+      frame_free (f);
+      return false;
+    }
+  return map_loaded (p, f);
+}
+
+/* Maps frame F, which was just filled with the contents of page
+   P, at P's user address and enters it in the frame table.  P
+   must be pinned.  If P cannot be mapped, frees F and returns
+   false. */
+static bool
+map_loaded (struct page *p, struct frame *f)
+{
+  if (!pagedir_set_frame (p->pagedir, p->upage, f->paddr, p->writable))
+    {
+      frame_free (f);
+      return false;
+    }
+  if (p->type == PAGE_FILE && !p->writable)
+    frame_install_text (f, p);
+  else
+    frame_install (f, p);
+  p->frame = f;
+  return true;
+}
+
+/* Maps page P, which was just added to the pages that share
+   frame F, to F, read-only.  Returns true if successful. */
+static bool
+map_shared (struct page *p, struct frame *f)
+{
+  if (!pagedir_set_frame (p->pagedir, p->upage, f->paddr, false))
+    {
+      frame_release (f, p);
+      return false;
+    }
+  p->frame = f;
+  return true;
+}
+
+/* Gives page P, which must be pinned, resident, and writable,
+   write access to its frame.  If the frame is shared with other
+   processes, P first gets a copy of its own.  Returns true if
+   successful, false if no frame can be had for the copy. */
+static bool
+page_unshare (struct page *p)
+{
+  struct frame *old = p->frame;
+  struct frame *new;
+  void *src, *dst;
+
+  if (!frame_is_shared (old))
+    {
+      pagedir_set_writable (p->pagedir, p->upage, true);
+      return true;
+    }
+
+  new = frame_alloc ();
+  if (new == NULL)
+    return false;
+  src = kmap (old->paddr);
+  dst = kmap (new->paddr);
+  memcpy (dst, src, PGSIZE);
+  kunmap (dst);
+  kunmap (src);
+
+  pagedir_clear_page (p->pagedir, p->upage);
+  frame_release (old, p);
+  frame_install (new, p);
+  p->frame = new;
+  pagedir_set_frame (p->pagedir, p->upage, new->paddr, true);
+  pagedir_set_dirty (p->pagedir, p->upage, true);
+  return true;
+}
+
+/* Reads page P, which must be pinned and in swap, into frame F
+   and maps it.  Along with P, reads whichever of the process's
+   neighbouring pages sit in the neighbouring swap slots, up to
+   SWAP_CLUSTER pages in all, as long as there are free frames
+   for them: a process that touches one page of a run it wrote
+   out together is likely to want the rest soon. */
+static void
+load_from_swap (struct page *p, struct frame *f)
+{
+  struct page *above[SWAP_CLUSTER - 1], *below[SWAP_CLUSTER - 1];
+  struct frame *above_f[SWAP_CLUSTER - 1], *below_f[SWAP_CLUSTER - 1];
+  struct page *run[SWAP_CLUSTER];
+  struct frame *frames[SWAP_CLUSTER];
+  void *kpages[SWAP_CLUSTER];
+  size_t above_cnt = 0, below_cnt = 0, cnt = 0;
+  size_t i;
+
+  while (1 + above_cnt + below_cnt < SWAP_CLUSTER
+         && (above[above_cnt] = grab_neighbour (p, above_cnt + 1,
+                                                &above_f[above_cnt])) != NULL)
+    above_cnt++;
+  while (1 + above_cnt + below_cnt < SWAP_CLUSTER
+         && (below[below_cnt] = grab_neighbour (p, -(int) below_cnt - 1,
+                                                &below_f[below_cnt])) != NULL)
+    below_cnt++;
+
+  /* Lay the run out in slot order and read it. */
+  for (i = below_cnt; i-- > 0; )
+    {
+      run[cnt] = below[i];
+      frames[cnt++] = below_f[i];
+    }
+  run[cnt] = p;
+  frames[cnt++] = f;
+  for (i = 0; i < above_cnt; i++)
+    {
+      run[cnt] = above[i];
+      frames[cnt++] = above_f[i];
+    }
+
+  for (i = 0; i < cnt; i++)
+    kpages[i] = kmap (frames[i]->paddr);
+  swap_read (run[0]->swap_slot, kpages, cnt);
+  thread_current ()->faults.swap += cnt;
+  for (i = 0; i < cnt; i++)
+    kunmap (kpages[i]);
+
+  for (i = 0; i < cnt; i++)
+    {
+      struct page *q = run[i];
+
+      /* The swap copy goes away, so the page must be written out
+         again if it is evicted, even if it is not modified. */
+      swap_free (q->swap_slot);
+      q->swap_slot = SWAP_NONE;
+      frame_install (frames[i], q);
+      q->frame = frames[i];
+      pagedir_set_frame (q->pagedir, q->upage, q->frame->paddr, q->writable);
+      pagedir_set_dirty (q->pagedir, q->upage, true);
+      if (q != p)
+        frame_unpin (q);
+    }
+}
+
+/* Returns the running process's page DELTA pages away from page
+   P, pinned and with a frame stored in *F, if that page is in
+   the swap slot DELTA slots away from P's and both a pin and a
+   free frame can be had without waiting.  Otherwise returns a
+   null pointer. */
+static struct page *
+grab_neighbour (const struct page *p, int delta, struct frame **f)
+{
+  uintptr_t upage = (uintptr_t) p->upage + (intptr_t) delta * PGSIZE;
+  size_t slot = p->swap_slot + delta;
+  struct page *q;
+
+  if ((delta < 0 && upage > (uintptr_t) p->upage)
+      || (delta < 0 && slot > p->swap_slot))
+    return NULL;
+
+  q = page_lookup ((void *) upage);
+  if (q == NULL || q->swap_slot != slot || !frame_try_pin (q))
+    return NULL;
+  if (q->swap_slot != slot)
+    {
+      /* Evicted and swapped elsewhere before we pinned it. */
+      frame_unpin (q);
+      return NULL;
+    }
+  *f = frame_try_alloc ();
+  if (*f == NULL)
+    {
+      frame_unpin (q);
+      return NULL;
+    }
+  return q;
+}
+
+/* Returns true if page A should come before page B in swap, that
+   is, if A belongs to an earlier page directory or to the same
+   one at a lower address. */
+static bool
+page_precedes (const struct page *a, const struct page *b)
+{
+  if (a->pagedir != b->pagedir)
+    return a->pagedir < b->pagedir;
+  return a->upage < b->upage;
+}
+
+/* Returns the first of the pages that share frame F. */
+static struct page *
+first_page (struct frame *f)
+{
+  return list_entry (list_front (&f->pages), struct page, frame_elem);
+}
+
+/* Unmaps frame F, all of whose pages must be pinned, from each
+   of its pages.  Returns true if any of them modified it. */
+static bool
+unmap_frame (struct frame *f)
+{
+  struct list_elem *e;
+  bool dirty = false;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+
+      ASSERT (p->busy);
+      ASSERT (p->frame == f);
+
+      pagedir_clear_page (p->pagedir, p->upage);
+      if (pagedir_is_dirty (p->pagedir, p->upage))
+        dirty = true;
+    }
+  return dirty;
+}
+
+/* Maps frame F, which unmap_frame() unmapped, back into each of
+   its pages, writable only if it is not shared, and sets their
+   dirty bits if DIRTY is true. */
+static void
+map_frame (struct frame *f, bool dirty)
+{
+  bool shared = list_begin (&f->pages) != list_rbegin (&f->pages);
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+
+      pagedir_set_frame (p->pagedir, p->upage, f->paddr,
+                         p->writable && !shared);
+      if (dirty)
+        pagedir_set_dirty (p->pagedir, p->upage, true);
+    }
+}
+
+/* Marks each page that shares frame F as no longer resident. */
+static void
+drop_frame (struct frame *f)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    list_entry (e, struct page, frame_elem)->frame = NULL;
+}
+
+/* Writes the CNT unmapped frames in FRAMES[] to the consecutive
+   swap slots starting at SLOT and takes them away from their
+   pages, all of which refer to the slot afterward. */
+static void
+write_run (struct frame *frames[], size_t cnt, size_t slot)
+{
+  void *kpages[SWAP_CLUSTER];
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    kpages[i] = kmap (frames[i]->paddr);
+  swap_write (slot, kpages, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      struct list_elem *e;
+
+      kunmap (kpages[i]);
+      for (e = list_begin (&frames[i]->pages);
+           e != list_end (&frames[i]->pages); e = list_next (e))
+        {
+          struct page *p = list_entry (e, struct page, frame_elem);
+
+          if (e != list_begin (&frames[i]->pages))
+            swap_share (slot + i);
+          p->swap_slot = slot + i;
+          p->frame = NULL;
+        }
+    }
+}
+
+/* Adds a page of type TYPE at UPAGE to the running process's
+   supplemental page table.  Returns the new page, or a null
+   pointer if UPAGE is already in use or memory is short. */
+static struct page *
+page_add (void *upage, bool writable, enum page_type type)
+{
+  struct page *p;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+
+  p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+  p->upage = upage;
+  p->pagedir = thread_current ()->pagedir;
+  p->writable = writable;
+  p->type = type;
+  p->busy = false;
+  p->frame = NULL;
+  p->swap_slot = SWAP_NONE;
+  p->file = NULL;
+  if (hash_insert (&thread_current ()->pages, &p->hash_elem) != NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  return p;
+}
+
+/* Returns a hash value for page E. */
+static unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return hash_bytes (&p->upage, sizeof p->upage);
+}
+
+/* Returns true if page A precedes page B. */
+static bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+  return a->upage < b->upage;
+}
+
+/* Frees page E. */
+static void
+page_destructor (struct hash_elem *e, void *aux UNUSED)
+{
+  page_free (hash_entry (e, struct page, hash_elem));
+}
+
+/* Frees page P, which is no longer in any supplemental page
+   table, and drops its frame and swap slot, writing it back
+   first if it is a modified PAGE_MMAP page.  If the frame table
+   is busy evicting P, waits for that to finish first. */
+static void
+page_free (struct page *p)
+{
+  if (frame_pin (p))
+    pagedir_clear_page (p->pagedir, p->upage);
+  page_drop (p);
+}
+
+/* Finishes freeing page P, which frame_pin() has pinned and
+   which is no longer mapped in its page directory. */
+static void
+page_drop (struct page *p)
+{
+  if (p->frame != NULL)
+    {
+      if (p->type == PAGE_MMAP && pagedir_is_dirty (p->pagedir, p->upage))
+        write_back (p);
+      frame_release (p->frame, p);
+    }
+  if (p->swap_slot != SWAP_NONE)
+    swap_free (p->swap_slot);
+  free (p);
+}
+
+/* Writes the part of PAGE_MMAP page P that belongs to its file,
+   which must be resident and pinned, back to the file. */
+static void
+write_back (struct page *p)
+{
+  void *kpage = kmap (p->frame->paddr);
+  file_write_at (p->file, kpage, p->read_bytes, p->file_ofs);
+  kunmap (kpage);
+}
@@ -0,0 +1,77 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct frame;
+struct thread;
+
+/* Where a page's initial contents come from. */
+enum page_type
+  {
+    PAGE_FILE,                  /* Read from a file, rest zeroed. */
+    PAGE_ZERO,                  /* All zeros. */
+    PAGE_MMAP                   /* Mapped file, written back to it. */
+  };
+
+/* A user virtual page, as recorded in its process's supplemental
+   page table.  Describes how to bring the page into memory the
+   first time it is touched, and where it went if it was evicted
+   since then. */
+struct page
+  {
+    struct hash_elem hash_elem; /* Element in thread's `pages'. */
+    void *upage;                /* User virtual address. */
+    uint32_t *pagedir;          /* Owning process's page directory. */
+    bool writable;              /* False for read-only pages. */
+    enum page_type type;        /* Source of initial contents. */
+
+    /* Owned by whoever set BUSY; see vm/frame.c. */
+    bool busy;                  /* Pinned or undergoing I/O. */
+    struct frame *frame;        /* Frame holding the page, or null. */
+    struct list_elem frame_elem; /* Element in FRAME's `pages'. */
+    size_t swap_slot;           /* Swap slot, or SWAP_NONE. */
+
+    /* PAGE_FILE and PAGE_MMAP only. */
+    struct file *file;          /* File to read. */
+    off_t file_ofs;             /* Offset in FILE. */
+    uint32_t read_bytes;        /* Bytes to read from FILE. */
+    uint32_t zero_bytes;        /* Bytes to zero after those. */
+  };
+
+/* Default limit on the size of a process's stack, in bytes. */
+#define STACK_MAX_DEFAULT (8 * 1024 * 1024)
+
+/* Limit on the size of a process's stack, in bytes.
+   Controlled by kernel command-line option "-stk". */
+extern size_t page_stack_max;
+
+/* Print each process's page fault statistics when it exits?
+   Controlled by kernel command-line option "-faults". */
+extern bool page_report_faults;
+
+void page_init (void);
+void page_table_init (void);
+void page_table_destroy (void);
+bool page_table_fork (struct thread *parent, struct file *exec_file);
+struct page *page_add_file (void *upage, struct file *, off_t ofs,
+                            uint32_t read_bytes, bool writable);
+struct page *page_add_zero (void *upage, bool writable);
+struct page *page_add_mmap (void *upage, struct file *, off_t ofs,
+                            uint32_t read_bytes);
+void page_remove (void *upage);
+void page_remove_range (void *upage, size_t page_cnt);
+struct page *page_lookup (const void *uaddr);
+bool page_is_stack (const void *uaddr);
+bool page_in (const void *fault_addr, bool write);
+void page_print_faults (void);
+void page_out (struct frame *frames[], size_t cnt);
+bool page_lock (const void *uaddr, bool write);
+void page_unlock (const void *uaddr);
+
+#endif /* vm/page.h */
@@ -0,0 +1,392 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <lz.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap area.
+
+   The swap device, if there is one, is divided into page-size
+   slots.  A bitmap records which slots are in use, and a count
+   per slot records how many pages refer to it: a page that
+   several processes share after fork() goes to a single slot.
+
+   Pages travel to and from swap in clusters of up to
+   SWAP_CLUSTER pages that occupy consecutive slots, so that a
+   cluster takes a single multi-sector transfer instead of one
+   transfer per sector.  The pages of a cluster are scattered
+   over memory, so they are gathered into (or scattered from) a
+   contiguous bounce buffer.
+
+   In front of the device sits a compressed tier: a fixed arena
+   of kernel pages, carved into ZSWAP_CHUNK-byte chunks, into
+   which swap_write() puts each page it can compress by at least
+   a quarter.  Such a page keeps its slot, so that the rest of
+   the VM does not need to know where it went, but its sectors
+   on the device are left alone.  Only pages that compress badly,
+   or that arrive when the arena is full, are written to disk.
+   swap_read() decompresses whatever it finds in the arena and
+   reads the rest from disk, and the chunks go back to the arena
+   when the slot is freed.  The arena's size is set with the
+   "-zswap" kernel command-line option. */
+
+/* Number of sectors in a page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* The swap device, or a null pointer if there is none. */
+static struct block *swap_device;
+
+/* Slots in use.  Null if there is no swap device. */
+static struct bitmap *swap_slots;
+
+/* Number of pages that refer to each slot. */
+static uint16_t *swap_refs;
+
+/* Protects swap_slots and swap_refs. */
+static struct lock swap_lock;
+
+/* Bounce buffer of SWAP_CLUSTER pages, and its lock. */
+static uint8_t *swap_buffer;
+static struct lock swap_io_lock;
+
+/* Bytes in one arena allocation unit. */
+#define ZSWAP_CHUNK 64
+
+/* Largest compressed page worth keeping. */
+#define ZSWAP_MAX_SIZE (PGSIZE - PGSIZE / 4)
+
+/* Pages in the compressed arena; 0 disables it. */
+size_t swap_zswap_pages = ZSWAP_PAGES_DEFAULT;
+
+/* Where a slot's page lives in the arena. */
+struct zswap_entry
+  {
+    uint16_t chunk;             /* First chunk. */
+    uint16_t size;              /* Compressed bytes, 0 if on disk. */
+  };
+
+/* Compressed arena, its chunks in use, and an entry per slot.
+   The chunk map and entries are protected by swap_lock.  The
+   arena is null if there is none. */
+static uint8_t *zswap_arena;
+static struct bitmap *zswap_chunks;
+static struct zswap_entry *zswap_entries;
+
+/* Compression output and scratch space.  Protected by
+   swap_io_lock. */
+static uint8_t *zswap_buffer;
+static void *zswap_work;
+
+static void zswap_init (void);
+static bool zswap_store (size_t slot, const void *kpage);
+static bool zswap_load (size_t slot, void *kpage);
+
+/* Statistics. */
+static unsigned long long write_ops;    /* Swap-out transfers. */
+static unsigned long long write_pages;  /* Pages swapped out. */
+static unsigned long long read_ops;     /* Swap-in transfers. */
+static unsigned long long read_pages;   /* Pages swapped in. */
+static unsigned long long zswap_stores; /* Pages put in the arena. */
+static unsigned long long zswap_bytes;  /* Their compressed size. */
+static unsigned long long zswap_rejects; /* Pages too big compressed. */
+static unsigned long long zswap_full;   /* Pages that found it full. */
+static unsigned long long zswap_hits;   /* Pages read from the arena. */
+
+/* Sets up the swap area on the block device that plays the
+   BLOCK_SWAP role, if any. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  lock_init (&swap_io_lock);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      printf ("swap: no swap device, swapping disabled\n");
+      return;
+    }
+
+  swap_slots = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  swap_buffer = palloc_get_multiple (0, SWAP_CLUSTER);
+  if (swap_slots != NULL)
+    swap_refs = malloc (bitmap_size (swap_slots) * sizeof *swap_refs);
+  if (swap_slots == NULL || swap_buffer == NULL || swap_refs == NULL)
+    PANIC ("swap: out of memory");
+  printf ("swap: %zu slots on %s\n",
+          bitmap_size (swap_slots), block_name (swap_device));
+
+  zswap_init ();
+}
+
+/* Allocates CNT consecutive free swap slots, each referred to
+   by one page, and returns the first, or SWAP_NONE if the swap
+   area is missing or has no such run of slots. */
+size_t
+swap_alloc (size_t cnt)
+{
+  size_t slot, i;
+
+  ASSERT (cnt > 0);
+
+  if (swap_slots == NULL)
+    return SWAP_NONE;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (swap_slots, 0, cnt, false);
+  if (slot != BITMAP_ERROR)
+    for (i = 0; i < cnt; i++)
+      swap_refs[slot + i] = 1;
+  lock_release (&swap_lock);
+  return slot != BITMAP_ERROR ? slot : SWAP_NONE;
+}
+
+/* Writes the CNT pages at KPAGES[] to the consecutive slots
+   starting at SLOT, which must have come from swap_alloc(). */
+void
+swap_write (size_t slot, void *const kpages[], size_t cnt)
+{
+  bool stored[SWAP_CLUSTER];
+  size_t i, j;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  ASSERT (bitmap_all (swap_slots, slot, cnt));
+
+  lock_acquire (&swap_io_lock);
+  for (i = 0; i < cnt; i++)
+    stored[i] = zswap_store (slot + i, kpages[i]);
+
+  /* Write each run of pages that the arena did not take. */
+  for (i = 0; i < cnt; i = j)
+    {
+      for (j = i; j < cnt && !stored[j]; j++)
+        memcpy (swap_buffer + (j - i) * PGSIZE, kpages[j], PGSIZE);
+      if (j == i)
+        {
+          j++;
+          continue;
+        }
+      block_write_multiple (swap_device, (slot + i) * PAGE_SECTORS,
+                            (j - i) * PAGE_SECTORS, swap_buffer);
+      write_ops++;
+      write_pages += j - i;
+    }
+  lock_release (&swap_io_lock);
+}
+
+/* Reads the CNT consecutive slots starting at SLOT into the
+   pages at KPAGES[].  The slots stay allocated. */
+void
+swap_read (size_t slot, void *const kpages[], size_t cnt)
+{
+  bool loaded[SWAP_CLUSTER];
+  size_t i, j, k;
+
+  ASSERT (cnt > 0 && cnt <= SWAP_CLUSTER);
+  ASSERT (bitmap_all (swap_slots, slot, cnt));
+
+  lock_acquire (&swap_io_lock);
+  for (i = 0; i < cnt; i++)
+    loaded[i] = zswap_load (slot + i, kpages[i]);
+
+  /* Read each run of pages that the arena did not have. */
+  for (i = 0; i < cnt; i = j)
+    {
+      j = i;
+      while (j < cnt && !loaded[j])
+        j++;
+      if (j == i)
+        {
+          j++;
+          continue;
+        }
+      block_read_multiple (swap_device, (slot + i) * PAGE_SECTORS,
+                           (j - i) * PAGE_SECTORS, swap_buffer);
+      for (k = i; k < j; k++)
+        memcpy (kpages[k], swap_buffer + (k - i) * PGSIZE, PGSIZE);
+      read_ops++;
+      read_pages += j - i;
+    }
+  lock_release (&swap_io_lock);
+}
+
+/* Records that one more page refers to swap slot SLOT. */
+void
+swap_share (size_t slot)
+{
+  ASSERT (slot != SWAP_NONE);
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_slots, slot));
+  ASSERT (swap_refs[slot] < UINT16_MAX);
+  swap_refs[slot]++;
+  lock_release (&swap_lock);
+}
+
+/* Drops one page's reference to swap slot SLOT, freeing the
+   slot if that was the last. */
+void
+swap_free (size_t slot)
+{
+  ASSERT (slot != SWAP_NONE);
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_slots, slot));
+  ASSERT (swap_refs[slot] > 0);
+  if (--swap_refs[slot] == 0)
+    {
+      bitmap_reset (swap_slots, slot);
+      if (zswap_arena != NULL && zswap_entries[slot].size != 0)
+        {
+          struct zswap_entry *z = &zswap_entries[slot];
+          bitmap_set_multiple (zswap_chunks, z->chunk,
+                               DIV_ROUND_UP (z->size, ZSWAP_CHUNK), false);
+          z->size = 0;
+        }
+    }
+  lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  if (swap_slots == NULL)
+    return;
+  printf ("Swap: %zu of %zu slots in use, "
+          "%llu pages out in %llu writes, %llu pages in in %llu reads\n",
+          bitmap_count (swap_slots, 0, bitmap_size (swap_slots), true),
+          bitmap_size (swap_slots), write_pages, write_ops,
+          read_pages, read_ops);
+  if (zswap_arena != NULL)
+    {
+      unsigned long long in = zswap_hits + read_pages;
+      unsigned long long ratio = (zswap_bytes != 0
+                                  ? zswap_stores * PGSIZE * 100 / zswap_bytes
+                                  : 0);
+
+      printf ("  compressed: %zu of %zu chunks in use, "
+              "%llu pages stored at %llu.%02llu:1, "
+              "%llu incompressible, %llu found arena full, "
+              "%llu of %llu pages in from RAM (%llu%%)\n",
+              bitmap_count (zswap_chunks, 0, bitmap_size (zswap_chunks), true),
+              bitmap_size (zswap_chunks), zswap_stores,
+              ratio / 100, ratio % 100, zswap_rejects, zswap_full,
+              zswap_hits, in, in != 0 ? zswap_hits * 100 / in : 0);
+    }
+}
+
+/* Sets up the compressed arena, unless it is disabled or memory
+   is short, in which case swapping goes straight to disk. */
+static void
+zswap_init (void)
+{
+  size_t slot_cnt = bitmap_size (swap_slots);
+  size_t chunk_cnt = swap_zswap_pages * (PGSIZE / ZSWAP_CHUNK);
+
+  if (swap_zswap_pages == 0)
+    return;
+  if (chunk_cnt > UINT16_MAX + 1)
+    {
+      swap_zswap_pages = (UINT16_MAX + 1) / (PGSIZE / ZSWAP_CHUNK);
+      chunk_cnt = UINT16_MAX + 1;
+    }
+
+  zswap_arena = palloc_get_multiple (0, swap_zswap_pages);
+  zswap_buffer = palloc_get_multiple (0, 2);
+  zswap_chunks = bitmap_create (chunk_cnt);
+  zswap_entries = calloc (slot_cnt, sizeof *zswap_entries);
+  if (zswap_arena == NULL || zswap_buffer == NULL || zswap_chunks == NULL
+      || zswap_entries == NULL)
+    {
+      printf ("swap: out of memory for compressed arena, disabled\n");
+      if (zswap_arena != NULL)
+        palloc_free_multiple (zswap_arena, swap_zswap_pages);
+      palloc_free_multiple (zswap_buffer, 2);
+      if (zswap_chunks != NULL)
+        bitmap_destroy (zswap_chunks);
+      free (zswap_entries);
+      zswap_arena = NULL;
+      return;
+    }
+  zswap_work = zswap_buffer + PGSIZE;
+  printf ("swap: %zu page compressed arena\n", swap_zswap_pages);
+}
+
+/* Compresses KPAGE into the arena as the contents of SLOT.
+   Returns true if successful, false if the page compresses
+   badly or does not fit, in which case it belongs on disk.
+   swap_io_lock must be held. */
+static bool
+zswap_store (size_t slot, const void *kpage)
+{
+  size_t size, chunk;
+
+  ASSERT (lock_held_by_current_thread (&swap_io_lock));
+
+  if (zswap_arena == NULL)
+    return false;
+
+  size = lz_compress (kpage, PGSIZE, zswap_buffer, ZSWAP_MAX_SIZE,
+                      zswap_work);
+  if (size == 0)
+    {
+      zswap_rejects++;
+      return false;
+    }
+
+  lock_acquire (&swap_lock);
+  chunk = bitmap_scan_and_flip (zswap_chunks, 0,
+                                DIV_ROUND_UP (size, ZSWAP_CHUNK), false);
+  if (chunk != BITMAP_ERROR)
+    {
+      zswap_entries[slot].chunk = chunk;
+      zswap_entries[slot].size = size;
+    }
+  lock_release (&swap_lock);
+  if (chunk == BITMAP_ERROR)
+    {
+      zswap_full++;
+      return false;
+    }
+
+  /* Nobody can look at the slot until swap_write() returns. */
+  memcpy (zswap_arena + chunk * ZSWAP_CHUNK, zswap_buffer, size);
+  zswap_stores++;
+  zswap_bytes += size;
+  return true;
+}
+
+/* Decompresses SLOT's contents into KPAGE, if they are in the
+   arena.  Returns true if so, false if they are on disk.
+   swap_io_lock must be held. */
+static bool
+zswap_load (size_t slot, void *kpage)
+{
+  struct zswap_entry z;
+
+  ASSERT (lock_held_by_current_thread (&swap_io_lock));
+
+  if (zswap_arena == NULL)
+    return false;
+
+  /* The caller's reference keeps the chunks in place. */
+  lock_acquire (&swap_lock);
+  z = zswap_entries[slot];
+  lock_release (&swap_lock);
+  if (z.size == 0)
+    return false;
+
+  if (!lz_decompress (zswap_arena + z.chunk * ZSWAP_CHUNK, z.size,
+                      kpage, PGSIZE))
+    PANIC ("swap: corrupt compressed page in slot %zu", slot);
+  zswap_hits++;
+  return true;
+}
@@ -0,0 +1,28 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* A swap slot that holds nothing. */
+#define SWAP_NONE ((size_t) -1)
+
+/* Most pages moved by a single swap I/O operation. */
+#define SWAP_CLUSTER 8
+
+/* Default size of the compressed arena, in pages. */
+#define ZSWAP_PAGES_DEFAULT 64
+
+/* Size of the compressed arena in front of the swap device, in
+   pages.  Controlled by kernel command-line option "-zswap". */
+extern size_t swap_zswap_pages;
+
+void swap_init (void);
+size_t swap_alloc (size_t cnt);
+void swap_write (size_t slot, void *const kpages[], size_t cnt);
+void swap_read (size_t slot, void *const kpages[], size_t cnt);
+void swap_share (size_t slot);
+void swap_free (size_t slot);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */